@@ -0,0 +1,1205 @@
+/*
+Copyright (c) 2021, JugadorXEI
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice,
+this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <iostream>
+#include <iomanip>
+#include <cstring>
+#include <filesystem>
+#include <cmath>
+#include <cstdlib>
+#include <cctype>
+#include <climits>
+#include <algorithm>
+#include "headers/commandplan.h"
+
+std::string_view unknownMessage = "Usage: wadcli [wad file] [arguments]...\n"
+	"Try 'wadcli --help' for more information.\n";
+
+CommandPlan::CommandPlan()
+	: wadFileName{}, outputName{}, exportFileName{}, listingOnly{ false }, explaining{ false },
+	compressAction{ CompressAction::NoCompress }, wadTypeAfterDecompress{ INVALID },
+	removingFiles{ false }, filesToRemove{}, patternsToRemove{},
+	addingFiles{ false }, filesToAdd{},
+	renamingFiles{ false }, filesToRename{},
+	inputtedFiles{ false }, filesToInput{}, inputPatterns{},
+	overridingFiles{ false },
+	createWADIfPossible{ false }, typeOfWADToCreate{ INVALID },
+	createMarkers{ false }, markersToCreate{},
+	mergingWADs{ false }, wadsToMerge{},
+	extractLumps{ false }, lumpsToExtract{}, patternsToExtract{},
+	extractAllLumps{ false },
+	noExtensionOnExport{ false },
+	exportPath{},
+	changePositions{ PositionAction::NoChange }, changePositionsRelative{ false }, toWhichPosition{ 0 },
+	addFilesWithinMarkers{ false }, markerName{},
+	numJobs{ ThreadPool::getDefaultNumThreads() }, maxMemory{ 0 }, useArena{ false },
+	compactWAD{ false },
+	askingForNames{ true },
+	steps{}
+{
+	// empty.
+}
+
+bool CommandPlan::parseArguments(const std::vector<std::string>& arguments, std::ostream& out)
+{
+	// Process parameters.
+	for (size_t i = 0; i < arguments.size(); ++i)
+	{
+		if constexpr (DEBUG) std::cout << i << ": " << arguments[i] << '\n';
+		if (i == 0) // Ignore argument in the first input.
+		{
+			// Is the first parameter an argument? A lone - is the standard input.
+			if (arguments[i][0] == '-' && arguments[i] != "-")
+			{
+				// It should be a wad instead.
+				out << "WADCLI: Error: Pass a WAD file first before using any arguments!\n" <<
+					unknownMessage;
+				return false;
+			}
+			else
+			{
+				wadFileName = arguments[i];
+			}
+
+			continue;
+		}
+
+		bool* booleanToChange{ nullptr };
+		std::vector<std::string>* listToAddTo{ nullptr };
+		std::string operationType{ "error" };
+
+		if (compressAction == CompressAction::NoCompress &&
+			(arguments[i] == "-c" || arguments[i] == "--compress"))
+		{
+			compressAction = ShouldCompress;
+			continue;
+		}
+		else if (compressAction == CompressAction::NoCompress &&
+			(arguments[i] == "-dc" || arguments[i] == "--decompress"))
+		{
+			compressAction = ShouldDecompress;
+		
+			char character = '0';
+			if (i < arguments.size() - 1)
+				character = arguments[++i][0];
+
+			switch (character)
+			{
+				case 'I': wadTypeAfterDecompress = IWAD; break;
+				default:  wadTypeAfterDecompress = PWAD; break;
+			}
+
+			continue;
+		}
+		else if (changePositions == PositionAction::NoChange &&
+			(arguments[i] == "-s" || arguments[i] == "--swap"))
+		{
+			changePositions = PositionAction::Swap;
+			continue;
+		}
+		else if (changePositions == PositionAction::NoChange &&
+			(arguments[i] == "-p" || arguments[i] == "--position"))
+		{
+			changePositions = PositionAction::Move;
+
+			std::string_view positionString{};
+			if (i < arguments.size() - 1)
+				positionString = arguments[++i];
+
+			if (positionString.empty())
+			{
+				out << "WADCLI: Used --position without setting a position!\n"; 
+				return false;
+			}
+
+			if (positionString[0] == '+' || positionString[0] == '-')
+				changePositionsRelative = true;		
+
+			toWhichPosition = atoi(positionString.data());
+			if (toWhichPosition == 0)
+			{
+				out << "WADCLI: --position's number argument parsed as zero, may be invalid.\n";
+				return false;
+			}
+
+			if constexpr (DEBUG)
+				std::cout << toWhichPosition << " - relative: " << changePositionsRelative << '\n';
+
+			continue;
+		}
+		else if (!addFilesWithinMarkers && arguments[i] == "--within")
+		{
+			addFilesWithinMarkers = true;
+
+			if (i < arguments.size() - 1)
+				markerName = arguments[++i];
+
+			if (markerName.empty())
+			{
+				out << "WADCLI: Used --within without setting a marker!\n";
+				return false;
+			}
+
+			if (markerName.size() > 2)
+				WadFormat::trimStringToMarkerCharacters(markerName);
+
+			continue;
+		}
+		else if (arguments[i] == "-j" || arguments[i] == "--jobs")
+		{
+			int jobs{ 0 };
+			if (i < arguments.size() - 1)
+				jobs = atoi(arguments[++i].c_str());
+
+			if (jobs < 1)
+			{
+				out << "WADCLI: --jobs needs a number of threads of at least 1!\n";
+				return false;
+			}
+
+			numJobs = static_cast<unsigned int>(jobs);
+			continue;
+		}
+		else if (arguments[i] == "--arena")
+		{
+			useArena = true;
+			continue;
+		}
+		else if (arguments[i] == "--max-memory")
+		{
+			char* sizeEnd{ nullptr };
+			if (i < arguments.size() - 1)
+				maxMemory = std::strtoull(arguments[++i].c_str(), &sizeEnd, 10);
+
+			switch (sizeEnd != nullptr ? std::toupper(*sizeEnd) : 0)
+			{
+				case 'K': maxMemory <<= 10; break;
+				case 'M': maxMemory <<= 20; break;
+				case 'G': maxMemory <<= 30; break;
+				default: break;
+			}
+
+			if (maxMemory == 0)
+			{
+				out << "WADCLI: --max-memory needs a size bigger than 0!\n";
+				return false;
+			}
+
+			continue;
+		}
+		else if (!overridingFiles && (arguments[i] == "-o" || arguments[i] == "--override"))
+		{
+			overridingFiles = true;
+			continue;
+		}
+		else if (arguments[i] == "--create")
+		{
+			createWADIfPossible = true;
+
+			char character = '0';
+			if (i < arguments.size() - 1)
+				character = arguments[++i][0];
+
+			switch (character)
+			{
+				case 'I': typeOfWADToCreate = IWAD; break;
+				case 'Z': typeOfWADToCreate = ZWAD; break;
+				default:  typeOfWADToCreate = PWAD; break;
+			}
+
+			continue;
+		}
+		else if (arguments[i] == "--output")
+		{
+			if (i < arguments.size() - 1)
+				outputName = arguments[++i];
+
+			if (outputName.empty())
+			{
+				out << "WADCLI: Used --output without setting any file name!\n"; 
+				return false;
+			}
+
+			continue;
+		}
+		else if (arguments[i] == "--explain")
+		{
+			explaining = true;
+			continue;
+		}
+		else if (arguments[i] == "--compact")
+		{
+			compactWAD = true;
+			continue;
+		}
+		else if (arguments[i] == "--extract-all")
+		{
+			extractAllLumps = true;
+			continue;	
+		}
+		else if (arguments[i] == "--no-extension")
+		{
+			noExtensionOnExport = true;
+			continue;
+		}
+		else if (arguments[i] == "--path")
+		{
+			if (i < arguments.size() - 1)
+				exportPath = arguments[++i];
+
+			if (exportPath.empty() || exportPath[0] == '-')
+			{
+				out << "WADCLI: Used --path without setting any path to export!\n"; 
+				return false;
+			}
+
+			std::filesystem::path pathToExport{ exportPath }; 
+			if (!std::filesystem::exists(pathToExport))
+			{
+				std::error_code error;
+				std::filesystem::create_directories(pathToExport, error);
+
+				if (error)
+				{
+					out << "WADCLI: An error has been found creating folders.\n" <<
+						error.message() << '\n';
+					return false;
+				}
+
+				out << "WADCLI: Successfully created folders: " << pathToExport << '\n';
+
+				/*
+				out << "WADCLI: Please point to a directory to export to!\n";
+				out << pathToExport << '\n';
+				return false;
+				*/
+			}
+
+			if (exportPath[exportPath.size()] != std::filesystem::path::preferred_separator)
+				exportPath += std::filesystem::path::preferred_separator;
+
+			continue;
+		}
+		// These are operations that take a list of arguments.
+		else if (arguments[i] == "-d" ||
+			arguments[i] == "--remove" ||
+			arguments[i] == "--delete")
+		{
+			booleanToChange = &removingFiles;
+			listToAddTo 	= &filesToRemove;
+			operationType	= "delete";
+		}
+		else if (arguments[i] == "-a" || arguments[i] == "--add")
+		{
+			booleanToChange = &addingFiles;
+			listToAddTo 	= &filesToAdd;
+			operationType 	= "add";
+		}
+		else if (arguments[i] == "-rn" || arguments[i] == "--rename")
+		{
+			booleanToChange = &renamingFiles;
+			listToAddTo 	= &filesToRename;
+			operationType	= "rename";
+		}
+		else if (arguments[i] == "-i" || arguments[i] == "--input")
+		{
+			booleanToChange = &inputtedFiles;
+			listToAddTo 	= &filesToInput;
+			operationType	= "input";
+		}
+		else if (arguments[i] == "--create-markers")
+		{
+			booleanToChange = &createMarkers;
+			listToAddTo		= &markersToCreate;
+			operationType	= "marker creation";
+		}
+		else if (arguments[i] == "-m" || arguments[i] == "--merge")
+		{
+			booleanToChange = &mergingWADs;
+			listToAddTo		= &wadsToMerge;
+			operationType	= "merging";
+		}
+		else if (arguments[i] == "-e" ||
+			arguments[i] == "--extract" ||
+			arguments[i] == "--export")
+		{
+			booleanToChange = &extractLumps;
+			listToAddTo		= &lumpsToExtract;
+			operationType	= "extract";			
+		}
+		else
+		{
+			out << "WADCLI: Unknown argument: " << arguments[i] << '\n';
+			return false;
+		}
+
+		size_t howMany{ 0 };
+
+		++i;
+		while (i < arguments.size() && arguments[i][0] != '-') // Don't add arguments, that'd be silly.
+		{
+			++howMany;
+
+			(*listToAddTo).push_back(arguments[i]);
+			if constexpr (DEBUG)
+				std::cout << i << ": " << arguments[i] << " (" << operationType << ")\n";
+
+			++i;
+		}
+		--i; // Since we're at a parameter, continuing the loop would skip it.
+
+		if (howMany > 0)
+			(*booleanToChange) = true;
+		else
+		{
+			// Nothing? Let's assume it's a mistake and stop.
+			out << "WADCLI: Used an " << operationType.c_str() << " operation without any arguments!\n"; 
+			return false;
+		}
+
+		// extra validation in case we're the last.
+		if (i == arguments.size())
+			break;
+			
+		continue;
+	}
+
+	// A WAD read from the standard input that gets changed is written back
+	// out to the standard output, unless it's going somewhere else.
+	listingOnly = arguments.size() == 1;
+	if (wadFileName == "-" && outputName.empty() && !listingOnly && !explaining &&
+		!(extractLumps || extractAllLumps))
+		outputName = "-";
+
+	if (wadFileName.empty())
+	{
+		out << "Error: no file name was given for WAD!\n";
+		out << unknownMessage;
+		return false;
+	}
+
+	// Lump names and patterns only get worked out the once.
+	// --input doesn't pick lumps when it goes with --add, it names them.
+	if (!CommandPlan::compilePatterns(filesToRemove, patternsToRemove, out) ||
+		!CommandPlan::compilePatterns(lumpsToExtract, patternsToExtract, out) ||
+		!CommandPlan::compilePatterns(filesToInput, inputPatterns, out))
+		return false;
+
+	return true;
+}
+
+bool CommandPlan::compilePatterns(const std::vector<std::string>& texts, std::vector<LumpPattern>& patterns,
+	std::ostream& out)
+{
+	patterns.resize(texts.size());
+	for (size_t i = 0; i < texts.size(); ++i)
+	{
+		std::string error{};
+		if (!patterns[i].compile(texts[i], error))
+		{
+			out << "WADCLI: Can't use " << texts[i] << " to pick lumps: " << error << ".\n";
+			return false;
+		}
+	}
+
+	return true;
+}
+
+std::vector<std::string> CommandPlan::findInputNames(WadFormat& wad) const
+{
+	std::vector<const LumpPattern*> patterns{};
+	for (const LumpPattern& pattern : inputPatterns)
+	{
+		if (!pattern.isExactName())
+			patterns.push_back(&pattern);
+	}
+
+	const std::vector<std::vector<unsigned int>> matches{ wad.findLumpsMatching(patterns) };
+	size_t patternAt{ 0 };
+
+	std::vector<std::string> names{};
+	for (size_t i = 0; i < inputPatterns.size(); ++i)
+	{
+		if (inputPatterns[i].isExactName())
+		{
+			names.push_back(filesToInput[i]);
+			continue;
+		}
+
+		// Lumps get moved by name, so the same name twice would just move the first one twice.
+		const size_t firstName{ names.size() };
+		for (unsigned int index : matches[patternAt])
+		{
+			std::string name{ wad[index].getName() };
+			if (std::find(names.begin() + firstName, names.end(), name) == names.end())
+				names.push_back(std::move(name));
+		}
+
+		++patternAt;
+	}
+
+	return names;
+}
+
+bool CommandPlan::buildPlan(WadType wadType, std::ostream& out)
+{
+	// Anything that can't work gets caught here, before anything is done to the WAD.
+	if (!exportPath.empty() && !(extractLumps || extractAllLumps || !outputName.empty()))
+	{
+		out << "WADCLI: --path requires --extract, --extract-all or --output.\n" <<
+			"Did you mean to use --input instead?\n";
+		return false;
+	}
+
+	if (changePositions != PositionAction::NoChange && !inputtedFiles)
+	{
+		out << "WADCLI: --position/--swap require --input to change/swap lump locations!\n";
+		return false;
+	}
+
+	if (changePositions == PositionAction::Swap && filesToInput.size() % 2 != 0)
+	{
+		out << "WADCLI: With --swap, lumps have to be given in pairs!\n";
+		return false;
+	}
+
+	if (changePositions == PositionAction::Swap && std::any_of(inputPatterns.begin(), inputPatterns.end(),
+		[](const LumpPattern& pattern) { return !pattern.isExactName(); }))
+	{
+		out << "WADCLI: With --swap, lumps have to be given by their exact names!\n";
+		return false;
+	}
+
+	if (!addingFiles && renamingFiles && !inputtedFiles)
+	{
+		out << "WADCLI: You must --input the files you wish to rename!\n";
+		return false;
+	}
+
+	// Nothing before these changes the WAD's type, so they'd fail anyway.
+	if (compressAction == ShouldCompress && wadType == ZWAD)
+	{
+		out << "WADCLI: Error: can't compress an already-compressed ZWAD!\n";
+		return false;
+	}
+
+	if (compressAction == ShouldDecompress && wadType != ZWAD)
+	{
+		out << "WADCLI: Error: can only decompress ZWADs!\n";
+		return false;
+	}
+
+	// The steps, in the order they've always been done in.
+	steps.clear();
+
+	if (mergingWADs)
+		steps.push_back({ StepType::MERGE_WADS });
+
+	if (removingFiles)
+		steps.push_back({ StepType::DELETE_LUMPS });
+
+	if (createMarkers)
+		steps.push_back({ StepType::CREATE_MARKERS });
+
+	// Files being added get their new names as they're added.
+	if (addingFiles)
+		steps.push_back({ StepType::ADD_FILES });
+	else if (renamingFiles)
+		steps.push_back({ StepType::RENAME_LUMPS });
+
+	if (changePositions != PositionAction::NoChange)
+	{
+		steps.push_back({ StepType::MOVE_LUMPS });
+		if (filesToInput.size() > 1)
+			steps.back().note = "All of them are worked out first, then the lumps get reordered once.";
+	}
+
+	if (extractAllLumps)
+	{
+		steps.push_back({ StepType::EXTRACT_ALL_LUMPS });
+		if (extractLumps)
+			steps.back().note = "--extract is dropped, every lump is extracted anyway.";
+	}
+	else if (extractLumps)
+		steps.push_back({ StepType::EXTRACT_LUMPS });
+
+	if (compressAction == ShouldCompress)
+		steps.push_back({ StepType::COMPRESS_WAD });
+	else if (compressAction == ShouldDecompress)
+	{
+		// Decompressing last would run over lumps merged or added uncompressed,
+		// so it goes first whenever anything before it touches lumps.
+		const bool touchesLumpsBefore{ std::any_of(steps.begin(), steps.end(), [](const PlanStep& step)
+			{
+				return step.type == StepType::MERGE_WADS || step.type == StepType::ADD_FILES ||
+					step.type == StepType::EXTRACT_LUMPS || step.type == StepType::EXTRACT_ALL_LUMPS;
+			}) };
+
+		if (touchesLumpsBefore)
+		{
+			steps.insert(steps.begin(), { StepType::DECOMPRESS_WAD,
+				"Moved to the front, so every lump after it is worked on uncompressed." });
+		}
+		else
+			steps.push_back({ StepType::DECOMPRESS_WAD });
+	}
+
+	// We're exporting the new wad.
+	exportFileName = wadFileName;
+	if (!outputName.empty())
+	{
+		if (!exportPath.empty() && outputName != "-")
+			exportFileName = exportPath + outputName;
+		else
+			exportFileName = outputName;
+	}
+
+	steps.push_back({ StepType::EXPORT_WAD });
+
+	return true;
+}
+
+void CommandPlan::explainPlan(std::ostream& out) const
+{
+	out << "WADCLI: Plan for " << wadFileName << ":\n";
+
+	size_t fullPasses{ 0 };
+	for (size_t i = 0; i < steps.size(); ++i)
+	{
+		const PlanStep& step{ steps[i] };
+		out << ' ' << (i + 1) << ". ";
+
+		switch (step.type)
+		{
+			case StepType::MERGE_WADS:
+				out << "merge " << wadsToMerge.size() << " WAD(s) into it";
+				break;
+			case StepType::DELETE_LUMPS:
+				out << "delete " << filesToRemove.size() << " name(s), index(es) or pattern(s) in one pass";
+				break;
+			case StepType::CREATE_MARKERS:
+				out << "create " << markersToCreate.size() << " pair(s) of markers";
+				break;
+			case StepType::ADD_FILES:
+				out << "add " << filesToAdd.size() << " file(s)";
+				if (addFilesWithinMarkers)
+					out << " within the " << markerName << "_START/" << markerName << "_END markers";
+				if (overridingFiles)
+					out << ", overwriting lumps with the same name";
+				break;
+			case StepType::RENAME_LUMPS:
+				out << "rename " << std::min(filesToInput.size(), filesToRename.size()) << " lump(s)";
+				break;
+			case StepType::MOVE_LUMPS:
+				if (changePositions == PositionAction::Swap)
+					out << "swap " << filesToInput.size() / 2 << " pair(s) of lumps";
+				else
+				{
+					out << "move " << filesToInput.size() << " lump(s) to " <<
+						(changePositionsRelative ? (std::signbit(toWhichPosition) ? "-" : "+") : "") <<
+						std::abs(toWhichPosition) << (changePositionsRelative ? " (relative)" : "");
+				}
+				break;
+			case StepType::EXTRACT_LUMPS:
+				out << "extract " << lumpsToExtract.size() << " lump(s)";
+				if (!exportPath.empty())
+					out << " into " << exportPath;
+				break;
+			case StepType::EXTRACT_ALL_LUMPS:
+				out << "extract every lump";
+				if (!exportPath.empty())
+					out << " into " << exportPath;
+				fullPasses++;
+				break;
+			case StepType::COMPRESS_WAD:
+				out << "compress every lump into a ZWAD";
+				fullPasses++;
+				break;
+			case StepType::DECOMPRESS_WAD:
+				out << "decompress every lump into a" << (wadTypeAfterDecompress == IWAD ? "n IWAD" : " PWAD");
+				fullPasses++;
+				break;
+			case StepType::EXPORT_WAD:
+				if (!(*this).changesWAD())
+				{
+					out << "nothing else, the WAD isn't written";
+					break;
+				}
+
+				out << "write the WAD to " << exportFileName;
+				if (compactWAD || exportFileName != wadFileName || exportFileName == "-")
+				{
+					out << ", rewriting all of it";
+					fullPasses++;
+				}
+				else
+					out << ", only appending what changed if it can";
+				break;
+		}
+
+		out << '\n';
+		if (!step.note.empty())
+			out << "    " << step.note << '\n';
+	}
+
+	out << "WADCLI: " << steps.size() << " step(s), " << fullPasses << " of them going over every lump.\n";
+}
+
+bool CommandPlan::executePlan(WadFormat& wad, std::ostream& out, bool exporting)
+{
+	for (const PlanStep& step : steps)
+	{
+		bool success{ false };
+		switch (step.type)
+		{
+			case StepType::MERGE_WADS:			success = (*this).mergeWADs(wad, out); break;
+			case StepType::DELETE_LUMPS:		success = (*this).deleteLumps(wad, out); break;
+			case StepType::CREATE_MARKERS:		success = (*this).addMarkers(wad, out); break;
+			case StepType::ADD_FILES:			success = (*this).addFiles(wad, out); break;
+			case StepType::RENAME_LUMPS:		success = (*this).renameLumps(wad, out); break;
+			case StepType::MOVE_LUMPS:			success = (*this).moveLumps(wad, out); break;
+			case StepType::EXTRACT_LUMPS:		success = (*this).extractSomeLumps(wad, out); break;
+			case StepType::EXTRACT_ALL_LUMPS:	success = (*this).extractEveryLump(wad, out); break;
+			case StepType::COMPRESS_WAD:		success = (*this).compressLumps(wad, out); break;
+			case StepType::DECOMPRESS_WAD:		success = (*this).decompressLumps(wad, out); break;
+			case StepType::EXPORT_WAD:
+				if (exporting)
+					success = (*this).exportLumps(wad, out);
+				else
+				{
+					if (extractLumps || extractAllLumps)
+						out << "WADCLI: All extraction operations finished.\n";
+					success = true;
+				}
+				break;
+		}
+
+		if (!success)
+			return false;
+	}
+
+	return true;
+}
+
+bool CommandPlan::mergeWADs(WadFormat& wad, std::ostream& out)
+{
+	for (std::string& name : wadsToMerge)
+	{
+		if (!std::filesystem::exists(name))
+		{
+			out << "WADCLI: There was an error reading " << name << '\n' <<
+				"It may not exist.\n";
+			continue;
+		}
+
+		WadFormat mergingWAD{};
+		mergingWAD.setThreadPool(wad.getThreadPool());
+		mergingWAD.setMaxMemory(maxMemory);
+
+		if (!mergingWAD.importWAD(name))
+		{
+			out << "WADCLI: There was an error reading " << name << '\n' <<
+				"We do not have permission to read it.\n";
+			continue;
+		}
+
+		if (wad.getWADType() != mergingWAD.getWADType())
+		{
+			if (wad.getWADType() == ZWAD && mergingWAD.getWADType() != ZWAD)
+				mergingWAD.compressWAD();
+			else if (wad.getWADType() != ZWAD && mergingWAD.getWADType() == ZWAD)
+				mergingWAD.decompressWAD();
+		}
+
+		// We're goooooood.
+		for (unsigned int i = 0; i < mergingWAD.getNumFiles(); ++i)
+			wad.addFileToWAD(mergingWAD[i]);
+
+		out << "WADCLI: Done merging WAD " << name <<
+			" into " << wadFileName << ".\n";
+	}
+
+	return true;
+}
+
+bool CommandPlan::deleteLumps(WadFormat& wad, std::ostream& out)
+{
+	// All of them go at once, so ?num is always the index from before removing anything.
+	std::vector<LumpSelector> selectors{};
+	for (size_t i = 0; i < filesToRemove.size(); ++i)
+	{
+		const LumpPattern& pattern{ patternsToRemove[i] };
+		if (pattern.isSingleIndex())
+		{
+			if constexpr (DEBUG) 
+				std::cout << "removing " << pattern.getFirstIndex() << " \n";
+			// by index.
+			selectors.push_back({ SelectType::BY_INDEX, filesToRemove[i], pattern.getFirstIndex() });
+		}
+		else if (!pattern.isExactName())
+			selectors.push_back({ SelectType::BY_PATTERN, filesToRemove[i], 0, &pattern });
+		else
+			selectors.push_back({ SelectType::BY_NAME, filesToRemove[i], 0 });
+	}
+
+	std::vector<uint8_t> removed{ wad.removeLumps(selectors) };
+	for (size_t i = 0; i < selectors.size(); ++i)
+	{
+		if (selectors[i].type == SelectType::BY_INDEX)
+		{
+			if (removed[i])
+				out << "WADCLI: Removed file #" << selectors[i].index << " from WAD.\n";
+		}
+		else if (removed[i])
+			out << "WADCLI: Removed file " << selectors[i].name << " from WAD.\n";
+		else
+			out << "WADCLI: Could not find file " << selectors[i].name << " to remove from WAD.\n";
+	}
+
+	return true;
+}
+
+bool CommandPlan::addMarkers(WadFormat& wad, std::ostream& /*out*/)
+{
+	// Sanity-check the marker names.
+	for (std::string& markerName : markersToCreate)
+	{
+		if (markerName.size() > 2)
+			WadFormat::trimStringToMarkerCharacters(markerName);
+
+		wad.createMarkers(markerName);
+	}
+
+	return true;
+}
+
+bool CommandPlan::addFiles(WadFormat& wad, std::ostream& out)
+{
+	size_t i{ 0 };
+	size_t success{ 0 };
+
+	MarkerRange markerRange{};
+	bool withinMarkers{ addFilesWithinMarkers };
+	if (withinMarkers && !wad.findMarkerRange(markerName, markerRange))
+	{
+		out << "WADCLI: Could not find marker " << markerName << "_END, " <<
+			"lumps will be placed at the end of the WAD.\n";
+		withinMarkers = false;
+	}
+
+	// Everything gets added at the end first, then moved inside the markers all at once.
+	std::vector<unsigned int> addedIndices{};
+	std::vector<std::string> addedNames{};
+
+	for (std::string& name : filesToAdd)
+	{
+		const unsigned int numFilesBefore{ wad.getNumFiles() };
+
+		std::string newName{ i < filesToRename.size() ? filesToRename[i] : "" };
+
+		// Nobody to ask for a shorter name, so the file's own gets cropped.
+		if (newName.empty() && !askingForNames && name.size() > 8)
+		{
+			newName = std::filesystem::path{ name }.filename().string().substr(0, 8);
+			out << "WADCLI: " << name << "'s name is too long, it was cropped to " << newName << ".\n";
+		}
+
+		if (wad.addFileToWAD(name.c_str(), newName, overridingFiles))
+		{
+			std::string realName{ !newName.empty() ? newName : name.c_str() };
+			out << "WADCLI: Added file " << realName << " to WAD.\n";
+
+			if (withinMarkers)
+			{
+				// Overwritten lumps stay where they were until now.
+				addedIndices.push_back(wad.getNumFiles() != numFilesBefore ?
+					wad.getNumFiles() - 1 : static_cast<unsigned int>(wad.findFileByName(realName)));
+				addedNames.push_back(realName);
+			}
+
+			++success;
+		}
+		else
+			out << "WADCLI: Can't read file " << name << ": it may not exist " <<
+				"or we are not allowed to read it.\n";
+
+		++i;
+	}
+
+	std::vector<unsigned int> newPositions{};
+	if (withinMarkers && wad.moveLumpsWithin(markerName, addedIndices, newPositions))
+	{
+		for (size_t j = 0; j < newPositions.size(); ++j)
+		{
+			if (newPositions[j] != UINT_MAX)
+				out << "WADCLI: Moved " << addedNames[j] << " to position " <<
+					newPositions[j] << ".\n";
+		}
+	}
+
+	if (success == 0)
+	{
+		out << "WADCLI: Error: there was trouble adding all files. Quitting early.\n";
+		return false;
+	}
+
+	return true;
+}
+
+bool CommandPlan::renameLumps(WadFormat& wad, std::ostream& out)
+{
+	// Patterns are looked for up front, so lumps renamed by one
+	// don't get picked up again by the ones after it.
+	std::vector<const LumpPattern*> patterns{};
+	for (size_t i = 0; i < inputPatterns.size() && i < filesToRename.size(); ++i)
+	{
+		if (!inputPatterns[i].isExactName())
+			patterns.push_back(&inputPatterns[i]);
+	}
+
+	const std::vector<std::vector<unsigned int>> matches{ wad.findLumpsMatching(patterns) };
+	size_t patternAt{ 0 };
+
+	size_t i{ 0 };
+	for (std::string& lumpName : filesToInput)
+	{
+		// handle cases where there's less renames than inputs.
+		if (i == filesToRename.size())
+			break;
+
+		const LumpPattern& pattern{ inputPatterns[i] };
+		if (!pattern.isExactName())
+		{
+			// Every lump it picks out gets a name from the template, $1 being what the first wildcard matched.
+			const std::vector<unsigned int>& indices{ matches[patternAt++] };
+			std::vector<std::string> captures{};
+			for (unsigned int index : indices)
+			{
+				const std::string oldName{ wad[index].getName() };
+				pattern.matchCaptures(oldName, captures);
+
+				const std::string newName{ LumpPattern::fillTemplate(filesToRename[i], captures) };
+				wad.renameFileByIndex(index, newName);
+				out << "WADCLI: Successfully renamed " << oldName <<
+					" into " << newName << ".\n";
+			}
+
+			if (indices.empty())
+				out << "WADCLI: Could not find lumps matching " << lumpName <<
+					" to rename into " << filesToRename[i] << ".\n";
+
+			i++;
+			continue;
+		}
+
+		int lumpIndex{ wad.findFileByName(lumpName) };
+		bool couldFindIt{ lumpIndex != -1 };
+
+		// We found it, so now we're renaming it.
+		if (couldFindIt)
+			wad.renameFileByIndex(static_cast<unsigned int>(lumpIndex), filesToRename[i]);
+
+		if (couldFindIt)
+			out << "WADCLI: Successfully renamed " << lumpName <<
+				" into " << filesToRename[i].c_str() << ".\n";
+		else
+			out << "WADCLI: Could not find lump " << lumpName <<
+				" to rename into " << filesToRename[i].c_str() << ".\n";
+
+		i++;
+	}
+		
+	// No fail condition in case rename fails because it would be a little weird...
+	// Just tell the user that they couldn't find the lump.
+
+	return true;
+}
+
+bool CommandPlan::moveLumps(WadFormat& wad, std::ostream& out)
+{
+	// Everything goes in one batch so the lumps only get shuffled around once.
+	std::vector<LumpMove> moves{};
+	if (changePositions == PositionAction::Swap)
+	{
+		for (size_t i = 0; i + 1 < filesToInput.size(); i += 2)
+			moves.push_back({ MoveType::SWAP_WITH, filesToInput[i], filesToInput[i + 1], 0, false });
+	}
+	else if (changePositions == PositionAction::Move)
+	{
+		for (std::string& lumpName : (*this).findInputNames(wad))
+		{
+			moves.push_back({ MoveType::MOVE_TO, lumpName, "",
+				changePositionsRelative ? toWhichPosition : toWhichPosition - 1,
+				changePositionsRelative });
+		}
+	}
+
+	std::vector<uint8_t> moved{ wad.moveLumps(moves) };
+	bool anySwapped{ false };
+
+	for (size_t i = 0; i < moves.size(); ++i)
+	{
+		const LumpMove& move{ moves[i] };
+		if (move.type == MoveType::SWAP_WITH)
+		{
+			if (moved[i])
+			{
+				out << "WADCLI: Lumps " << move.name <<
+					" and " << move.otherName << " were successfully swapped.\n";
+				anySwapped = true;
+			}
+			else
+			{
+				out << "WADCLI: Could not find lumps " << move.name <<
+					" and " << move.otherName << " to swap.\n";
+			}
+		}
+		else if (moved[i])
+		{
+			out << "WADCLI: " << move.name << " moved successfully to " <<
+				(changePositionsRelative ?
+				(std::signbit(toWhichPosition) ? "-" : "+")
+				 : "") << std::abs(toWhichPosition) <<
+				(changePositionsRelative ? " (relative)" : "") << ".\n";
+		}
+		else
+			out << "WADCLI: We either could not find the lump " << move.name << '\n' <<
+				"to move, or the movement would have made the lump\n" << 
+				"go out of bounds.\n";
+	}
+
+	// set to no change - if this was the only thing done, then the wad will not re-export.
+	if (changePositions == PositionAction::Swap && !anySwapped)
+		changePositions = PositionAction::NoChange;
+
+	return true;
+}
+
+bool CommandPlan::extractEveryLump(WadFormat& wad, std::ostream& out)
+{
+	std::vector<uint8_t> extracted{ wad.extractAllLumps(noExtensionOnExport, exportPath) };
+
+	for (unsigned int i = 0; i < wad.getNumFiles(); ++i)
+	{
+		if (extracted[i])
+			out << "WADCLI: Successfully extracted " << wad[i].getName() << ".\n";
+	}
+
+	return true;
+}
+
+bool CommandPlan::extractSomeLumps(WadFormat& wad, std::ostream& out)
+{
+	if (lumpsToExtract.empty())
+	{
+		out << "WADCLI: You must provide the lump names you wish to extract!\n";
+		return false;
+	}
+
+	std::vector<const LumpPattern*> patterns{};
+	for (const LumpPattern& pattern : patternsToExtract)
+		patterns.push_back(&pattern);
+
+	const std::vector<std::vector<unsigned int>> matches{ wad.findLumpsMatching(patterns) };
+
+	for (size_t i = 0; i < lumpsToExtract.size(); ++i)
+	{
+		bool wasFound{ false };
+
+		// We found it, so now we're extracting it. Exact names
+		// only ever meant the first lump with that name.
+		for (unsigned int lumpIndex : matches[i])
+		{
+			if (wad.extractLump(wad[lumpIndex], noExtensionOnExport, exportPath.empty() ? "" : exportPath))
+			{
+				out << "WADCLI: Successfully extracted " <<
+					(patternsToExtract[i].isExactName() ? lumpsToExtract[i] : wad[lumpIndex].getName()) << ".\n";
+				wasFound = true;
+			}
+
+			if (patternsToExtract[i].isExactName())
+				break;
+		}
+
+		if (!wasFound)
+			out << "WADCLI: Could not find lump " << lumpsToExtract[i] << ".\n";
+	}
+
+	return true;
+}
+
+bool CommandPlan::compressLumps(WadFormat& wad, std::ostream& out)
+{
+	if (wad.getWADType() == ZWAD)
+	{
+		out << "WADCLI: Error: can't compress an already-compressed ZWAD!\n";
+		return false;
+	}
+
+	out << "WADCLI: Compressing WAD " << wad.getWADName() << "...\n";
+
+	if (wad.compressWAD())
+		out << "WADCLI: Compressed WAD successfully.\n";
+	else
+	{
+		out << "WADCLI: There was an error compressing the WAD!\n";
+		return false;
+	}
+
+	return true;
+}
+
+bool CommandPlan::decompressLumps(WadFormat& wad, std::ostream& out)
+{
+	if (wad.getWADType() != ZWAD)
+	{
+		out << "WADCLI: Error: can only decompress ZWADs!\n";
+		return false;
+	}
+
+	out << "WADCLI: Decompressing ZWAD " << wad.getWADName() << "...\n";
+	
+	if (wad.decompressWAD(wadTypeAfterDecompress))
+		out << "WADCLI: Decompressed WAD successfully.\n";
+	else
+	{
+		out << "WADCLI: There was an error decompressing the WAD!\n";
+		return false;
+	}
+
+	return true;
+}
+
+bool CommandPlan::exportLumps(WadFormat& wad, std::ostream& out)
+{
+	if (extractLumps || extractAllLumps)
+		out << "WADCLI: All extraction operations finished.\n";
+
+	if ((*this).changesWAD())
+		return wad.exportWAD(exportFileName, compactWAD ? ExportMode::REWRITE : ExportMode::IN_PLACE);
+
+	if (!(extractLumps || extractAllLumps))
+	{
+		out << "WADCLI: No action was done.\n" <<
+			"Arguments might have been misused.\n";
+	}
+
+	return true;
+}
+
+void CommandPlan::listWAD(WadFormat& wad, std::ostream& out)
+{
+	out << "WAD: " << wad.getWADName() << " (" << wad.getWADTypeToChar() << ")" << '\n';
+
+	unsigned int numFiles = wad.getNumFiles();
+	out << "Files (" << numFiles << "):\n";
+	for (unsigned int i = 0; i < numFiles; ++i)
+	{
+		out << "File " << (i + 1) << ": " << wad[i].getName() << " (Size: " << wad[i].getSize() << ", Offset: " << wad[i].getOffset() << ")" << '\n';
+	}
+
+	out << "Done reading " << wad.getWADName() << '\n';
+}
+
+bool CommandPlan::runOnWAD(std::shared_ptr<ThreadPool> threadPool, std::ostream& out)
+{
+	const bool readingStandardInput{ wadFileName == "-" };
+
+	// Just listing the WAD, or saying what we'd do to it, doesn't need any of the lumps.
+	const ImportMode importMode{ listingOnly || explaining ? DIRECTORY_ONLY :
+		(useArena ? ARENA : MAPPED) };
+
+	// Let's create the wad object.
+	WadFormat wad{ wadFileName, typeOfWADToCreate };
+	if (readingStandardInput || std::filesystem::exists(wadFileName))
+	{
+		if (!wad.importWAD(wadFileName, importMode))
+		{
+			out << "WADCLI: There was an error reading " <<
+				std::quoted(wadFileName) << ".\n" <<
+				"We are not allowed to read it.\n";
+			return false;
+		}
+	}
+	else if (!createWADIfPossible)
+	{
+		out << "WADCLI: There was an error reading " << 
+			std::quoted(wadFileName) << ".\n" <<
+			"It may not exist.\n";
+		return false;
+	}
+
+	// We're just reading the file.
+	if (listingOnly)
+	{
+		CommandPlan::listWAD(wad, out);
+		return true;
+	}
+
+	if (!(*this).buildPlan(wad.getWADType(), out))
+		return false;
+
+	if (explaining)
+	{
+		(*this).explainPlan(out);
+		return true;
+	}
+
+	wad.setThreadPool(threadPool);
+	wad.setMaxMemory(maxMemory);
+
+	return (*this).executePlan(wad, out);
+}
+
+bool CommandPlan::changesWAD() const
+{
+	return compressAction != NoCompress ||
+		addingFiles ||
+		removingFiles ||
+		renamingFiles ||
+		createWADIfPossible ||
+		createMarkers ||
+		mergingWADs ||
+		compactWAD ||
+		!outputName.empty() ||
+		changePositions != NoChange;
+}
+
+void CommandPlan::setWADFileName(const std::string& fileName) { wadFileName = fileName; }
+void CommandPlan::setMaxMemory(uint64_t maxBytes) { maxMemory = maxBytes; }
+void CommandPlan::setAskingForNames(bool asking) { askingForNames = asking; }
+
+const std::string& CommandPlan::getWADFileName() const { return wadFileName; }
+const std::string& CommandPlan::getOutputName() const { return outputName; }
+const std::string& CommandPlan::getExportFileName() const { return exportFileName; }
+bool CommandPlan::isCompacting() const { return compactWAD; }
+const std::vector<PlanStep>& CommandPlan::getSteps() const { return steps; }
+WadType CommandPlan::getTypeOfWADToCreate() const { return typeOfWADToCreate; }
+bool CommandPlan::isListingOnly() const { return listingOnly; }
+bool CommandPlan::isExplaining() const { return explaining; }
+bool CommandPlan::canCreateWAD() const { return createWADIfPossible; }
+bool CommandPlan::usesArena() const { return useArena; }
+unsigned int CommandPlan::getNumJobs() const { return numJobs; }
+uint64_t CommandPlan::getMaxMemory() const { return maxMemory; }
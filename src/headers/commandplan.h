@@ -0,0 +1,229 @@
+/*
+Copyright (c) 2021, JugadorXEI
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice,
+this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef JUG_COMMANDPLAN_H
+#define JUG_COMMANDPLAN_H
+
+#include <cstdint>
+#include <vector>
+#include <string>
+#include <ostream>
+#include <memory>
+
+#include "wadformat.h"
+#include "lumppattern.h"
+
+extern std::string_view unknownMessage;
+
+enum CompressAction
+{
+	NoCompress = 0,
+	ShouldCompress = 1,
+	ShouldDecompress = 2
+};
+
+enum PositionAction
+{
+	NoChange = 0,
+	Swap = 1,
+	Move = 2
+};
+
+enum StepType
+{
+	MERGE_WADS			= 0,
+	DELETE_LUMPS		= 1,
+	CREATE_MARKERS		= 2,
+	ADD_FILES			= 3,
+	RENAME_LUMPS		= 4,
+	MOVE_LUMPS			= 5,
+	EXTRACT_LUMPS		= 6,
+	EXTRACT_ALL_LUMPS	= 7,
+	COMPRESS_WAD		= 8,
+	DECOMPRESS_WAD		= 9,
+	EXPORT_WAD			= 10
+};
+
+// One thing to do to the WAD, with a note if it isn't done the way
+// it's always been.
+struct PlanStep
+{
+	StepType type{ StepType::EXPORT_WAD };
+	std::string note{};
+};
+
+// Everything one wadcli command line asks for, as a list of steps that get
+// run one after the other on a WAD that's already loaded.
+class CommandPlan
+{
+public:
+	CommandPlan();
+
+	// Reads the arguments like the command line always has, the WAD's name first.
+	// Returns false if they don't make sense, after saying why to out.
+	bool parseArguments(const std::vector<std::string>& arguments, std::ostream& out);
+
+	// Works out the steps for a WAD of this type, in the order they've always been
+	// done in, except for a --decompress that has to go first.
+	// Returns false if something can't be done at all, before anything was done.
+	bool buildPlan(WadType wadType, std::ostream& out);
+	void explainPlan(std::ostream& out) const;
+
+	// Runs the steps on the WAD, stops at the first one that goes wrong.
+	// Without exporting, the WAD is left for whoever ran it to write.
+	bool executePlan(WadFormat& wad, std::ostream& out, bool exporting = true);
+
+	// Whether there's anything to write back at all. Swaps that all
+	// failed don't count, so this can change while the plan runs.
+	bool changesWAD() const;
+
+	// What plain "wadcli yourwad.wad" prints.
+	static void listWAD(WadFormat& wad, std::ostream& out);
+
+	// Everything a parsed command line does: reads the WAD, then lists it, explains
+	// the plan or runs it. Without a thread pool, it's all done on this thread.
+	// Returns false if the WAD couldn't be read or the plan didn't go through.
+	bool runOnWAD(std::shared_ptr<ThreadPool> threadPool, std::ostream& out);
+
+	// For running the same arguments on some other WAD.
+	void setWADFileName(const std::string& fileName);
+	void setMaxMemory(uint64_t maxBytes);
+	// Without anyone at the terminal (scripts, servers, lots of WADs at once),
+	// files with long names get them cropped instead of asking for a new one.
+	void setAskingForNames(bool asking);
+
+	const std::string& getWADFileName() const;
+	const std::string& getOutputName() const;
+	const std::string& getExportFileName() const;
+	bool isCompacting() const;
+	const std::vector<PlanStep>& getSteps() const;
+	WadType getTypeOfWADToCreate() const;
+	bool isListingOnly() const;
+	bool isExplaining() const;
+	bool canCreateWAD() const;
+	bool usesArena() const;
+	unsigned int getNumJobs() const;
+	uint64_t getMaxMemory() const;
+
+private:
+	// Input - Output
+	std::string wadFileName;
+	std::string outputName;
+	std::string exportFileName;
+	bool listingOnly;
+	bool explaining;
+
+	// Compression
+	CompressAction compressAction;
+	WadType wadTypeAfterDecompress;
+
+	// Deleting files
+	bool removingFiles;
+	std::vector<std::string> filesToRemove;
+	std::vector<LumpPattern> patternsToRemove;
+
+	// Adding files
+	bool addingFiles;
+	std::vector<std::string> filesToAdd;
+
+	// Renaming files
+	bool renamingFiles;
+	std::vector<std::string> filesToRename;
+
+	// Input files
+	bool inputtedFiles;
+	std::vector<std::string> filesToInput;
+	std::vector<LumpPattern> inputPatterns;
+
+	// Overriding files
+	bool overridingFiles;
+
+	// Create the WAD
+	bool createWADIfPossible;
+	WadType typeOfWADToCreate;
+
+	// Create markers
+	bool createMarkers;
+	std::vector<std::string> markersToCreate;
+
+	// Merging WADS
+	bool mergingWADs;
+	std::vector<std::string> wadsToMerge;
+
+	// Extract lumps
+	bool extractLumps;
+	std::vector<std::string> lumpsToExtract;
+	std::vector<LumpPattern> patternsToExtract;
+
+	// Extract all lumps
+	bool extractAllLumps;
+
+	// No extension on export
+	bool noExtensionOnExport;
+
+	// Path to export to.
+	std::string exportPath;
+
+	// Swap or change lump positions
+	PositionAction changePositions;
+	bool changePositionsRelative;
+	int toWhichPosition;
+
+	// Add within markers
+	bool addFilesWithinMarkers;
+	std::string markerName;
+
+	// Threads to work with
+	unsigned int numJobs;
+	uint64_t maxMemory;
+	bool useArena;
+
+	// Rewrite the WAD from scratch
+	bool compactWAD;
+
+	// Ask for names that are too long
+	bool askingForNames;
+
+	std::vector<PlanStep> steps;
+
+	static bool compilePatterns(const std::vector<std::string>& texts, std::vector<LumpPattern>& patterns,
+		std::ostream& out);
+	// Every lump name the inputs pick out, patterns worked out against the WAD as it is now.
+	std::vector<std::string> findInputNames(WadFormat& wad) const;
+
+	bool mergeWADs(WadFormat& wad, std::ostream& out);
+	bool deleteLumps(WadFormat& wad, std::ostream& out);
+	bool addMarkers(WadFormat& wad, std::ostream& out);
+	bool addFiles(WadFormat& wad, std::ostream& out);
+	bool renameLumps(WadFormat& wad, std::ostream& out);
+	bool moveLumps(WadFormat& wad, std::ostream& out);
+	bool extractSomeLumps(WadFormat& wad, std::ostream& out);
+	bool extractEveryLump(WadFormat& wad, std::ostream& out);
+	bool compressLumps(WadFormat& wad, std::ostream& out);
+	bool decompressLumps(WadFormat& wad, std::ostream& out);
+	bool exportLumps(WadFormat& wad, std::ostream& out);
+};
+
+#endif
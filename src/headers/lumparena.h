@@ -0,0 +1,63 @@
+/*
+Copyright (c) 2021, JugadorXEI
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice,
+this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef JUG_LUMPARENA_H
+#define JUG_LUMPARENA_H
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+
+#include "mappedfile.h"
+
+// Hands out room for lumps from a few big blocks instead of
+// one allocation per lump. Safe to use from the thread pool.
+class LumpArena
+{
+public:
+	static const size_t defaultBlockSize{ 16 << 20 };
+
+	LumpArena(size_t newBlockSize = defaultBlockSize);
+
+	LumpArena(const LumpArena&) = delete;
+	LumpArena& operator=(const LumpArena&) = delete;
+
+	// Copies data into the arena and returns where it ended up, or nullptr if
+	// there's no memory for it. block is set to whatever owns the copy.
+	const char* store(const char* data, size_t dataSize, std::shared_ptr<MappedFile>& block);
+
+	size_t getNumBlocks();
+	size_t getNumStored();
+
+private:
+	std::mutex mutex;
+	std::shared_ptr<MappedFile> currentBlock;
+	size_t used;
+	size_t blockSize;
+	size_t numBlocks;
+	size_t numStored;
+};
+
+#endif
@@ -0,0 +1,126 @@
+/*
+Copyright (c) 2021, JugadorXEI
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice,
+this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef JUG_LUMPPATTERN_H
+#define JUG_LUMPPATTERN_H
+
+#include <cstdint>
+#include <vector>
+#include <string>
+#include <string_view>
+#include <regex>
+
+enum NameMatch
+{
+	ANY_NAME	= 0,	// Nothing to check, it's all in the range or scope.
+	EXACT_NAME	= 1,	// That name and nothing else.
+	GLOB_NAME	= 2,	// * for any characters, ? for just one.
+	REGEX_NAME	= 3		// A regular expression, for the whole name.
+};
+
+// One way of picking out lumps, as given on the command line:
+//   NAME			that exact name.
+//   DS*, ?_START	globs: * matches any characters, ? just one.
+//   ~DS(PI|SH).*	a regular expression (ECMAScript), after the ~.
+//   ?5, ?100-200	the lump at that position, or all of them between, counting from 1.
+//   S_START..S_END	everything between those two lumps, not counting them.
+// Positions and scopes can be followed by :name to only pick some of them,
+// like ?1-50:D* or S_START..S_END:TROO*.
+// It gets worked out once, then WadFormat::findLumpsMatching() checks
+// every name against it in one go over the file list.
+class LumpPattern
+{
+public:
+	LumpPattern();
+
+	// Returns false if it doesn't make sense, and says why in error.
+	bool compile(std::string_view pattern, std::string& error);
+
+	const std::string& getText() const;
+
+	// Just a name, so the name index can find it without looking at every lump.
+	bool isExactName() const;
+	// Just ?num, the way --delete has always taken it.
+	bool isSingleIndex() const;
+
+	bool hasIndexRange() const;
+	unsigned int getFirstIndex() const;	// Counting from 0.
+	unsigned int getLastIndex() const;	// Same, and it's included.
+
+	bool hasScope() const;
+	const std::string& getScopeStart() const;
+	const std::string& getScopeEnd() const;
+
+	const std::string& getName() const;
+
+	// Names longer than 8 characters aren't any lump's.
+	bool canMatch() const;
+
+	// Checks a packed name (see WadFormat::packLumpName()), range and scope aside.
+	bool matchesName(uint64_t packedName) const;
+
+	// Names can only match if (packedName & mask) == value, which NameScan can check
+	// for lots of them at once. If the mask decides, matchesName() has nothing to add.
+	uint64_t getNameMask() const;
+	uint64_t getNameValue() const;
+	bool isDecidedByMask() const;
+
+	// Same, but also keeps what each * and ? (or each regex group) matched, for
+	// fillTemplate(). The first one is always the whole name.
+	bool matchCaptures(std::string_view name, std::vector<std::string>& captures) const;
+
+	// $1 to $9 become what was captured, $0 the whole name and $$ a $.
+	static std::string fillTemplate(std::string_view nameTemplate, const std::vector<std::string>& captures);
+
+	// Plain glob matching, for anything else that takes * and ?.
+	static bool matchesGlob(std::string_view name, std::string_view glob,
+		std::vector<std::string>* captures = nullptr);
+
+private:
+	std::string text;
+
+	NameMatch nameMatch;
+	std::string name;
+	std::regex nameRegex;
+
+	// Whatever comes before the first * sits at a known place in the name,
+	// which is one AND and one compare on a packed name. Names with no *
+	// also have to end in the right place. Sometimes that's all there is to it.
+	uint64_t nameMask;
+	uint64_t nameValue;
+	bool maskDecides;
+	bool tooLong;
+
+	bool indexRange;
+	unsigned int firstIndex;
+	unsigned int lastIndex;
+
+	std::string scopeStart;
+	std::string scopeEnd;
+
+	bool compileName(std::string_view namePattern, std::string& error);
+};
+
+#endif
@@ -0,0 +1,97 @@
+/*
+Copyright (c) 2021, JugadorXEI
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice,
+this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef JUG_MAPPEDFILE_H
+#define JUG_MAPPEDFILE_H
+
+#include <cstddef>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Read-only memory mapping of a whole file, or a block of memory standing in
+// for one. Lumps imported from a mapped WAD point straight into it,
+// so the file stays mapped for as long as any lump uses it.
+class MappedFile
+{
+public:
+	MappedFile();
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	bool openFile(std::string_view fileName);
+	void closeFile();
+
+	// Copies everything left in input into an anonymous temporary file and
+	// maps that instead, for pipes and other things that can't be mapped.
+	bool openStream(FILE* input);
+
+	// Same, but for a bunch of buffers that would rather not stay in memory.
+	bool openBuffers(const std::vector<std::string_view>& buffers);
+
+	// Reads the whole file into a block of memory of its own instead of mapping it.
+	bool readFile(std::string_view fileName);
+
+	// Just a block of memory, no file behind it at all.
+	bool allocate(size_t newSize);
+	bool adopt(std::vector<char>&& buffer); // Takes the buffer over without copying it.
+	bool isInMemory();
+
+	const char*		getData();
+	char*			getWritableData(); // Only for memory blocks, nullptr otherwise.
+	size_t			getSize();
+	std::string&	getFileName();
+
+	// Copies part of the file to the end of outFile, letting the kernel do it
+	// where it can. Returns how many bytes it managed, anything left over is
+	// up to the caller to write.
+	size_t copyRangeTo(FILE* outFile, size_t offset, size_t length);
+
+	// Lets go of the memory behind part of the mapping we're done reading.
+	// The data is still there, it just gets read from the file again if needed.
+	void releaseRange(const char* start, size_t length);
+
+private:
+	bool mapFile();
+	bool mapSpool(FILE* spool);
+
+	std::string fileName;
+	const char* data;
+	size_t		size;
+
+	std::vector<char> memory;
+
+#ifdef _WIN32
+	void* fileHandle;
+	void* mappingHandle;
+#else
+	int fileDescriptor;
+#endif
+};
+
+#endif
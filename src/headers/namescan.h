@@ -0,0 +1,66 @@
+/*
+Copyright (c) 2021, JugadorXEI
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice,
+this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef JUG_NAMESCAN_H
+#define JUG_NAMESCAN_H
+
+#include <cstdint>
+#include <vector>
+
+// Goes through packed lump names (see WadFormat::packLumpName()) looking for
+// the ones that have certain bytes in certain places. With SSE2 that's 2 names
+// per compare and with AVX2 it's 4, whichever the CPU running us has.
+class NameScan
+{
+public:
+	// Appends the index of every name in [first, last) where (name & mask) == value.
+	static void findMatching(const uint64_t* names, uint32_t first, uint32_t last,
+		uint64_t mask, uint64_t value, std::vector<unsigned int>& found);
+
+	// Which one findMatching() ended up using: "AVX2", "SSE2" or "scalar".
+	static const char* getKernelName();
+
+	// Each one on its own, so they can be checked against each other.
+	// The vector ones need a CPU that has them, findMatching() makes sure of that.
+	static void findMatchingScalar(const uint64_t* names, uint32_t first, uint32_t last,
+		uint64_t mask, uint64_t value, std::vector<unsigned int>& found);
+	static void findMatchingSSE2(const uint64_t* names, uint32_t first, uint32_t last,
+		uint64_t mask, uint64_t value, std::vector<unsigned int>& found);
+	static void findMatchingAVX2(const uint64_t* names, uint32_t first, uint32_t last,
+		uint64_t mask, uint64_t value, std::vector<unsigned int>& found);
+
+private:
+	using Kernel = void (*)(const uint64_t*, uint32_t, uint32_t, uint64_t, uint64_t, std::vector<unsigned int>&);
+
+	struct KernelChoice
+	{
+		Kernel kernel;
+		const char* name;
+	};
+
+	static const KernelChoice& getKernel();
+};
+
+#endif
@@ -0,0 +1,87 @@
+/*
+Copyright (c) 2021, JugadorXEI
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice,
+this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef JUG_THREADPOOL_H
+#define JUG_THREADPOOL_H
+
+#include <cstdint>
+#include <atomic>
+#include <exception>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+// Fixed set of worker threads that run batches of numbered tasks.
+// Every worker has its own queue and steals from the others' once it runs
+// dry, so one slow task doesn't leave everyone else waiting on its queue.
+class ThreadPool
+{
+public:
+	ThreadPool(unsigned int numThreads = ThreadPool::getDefaultNumThreads());
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	// Runs task on every number in tasks and waits for all of them.
+	// Tasks are handed out in the order given, so put the slowest first.
+	// If a task throws, the rest are skipped and the first exception is
+	// thrown again from here. Tasks can't run tasks on the same pool.
+	void runTasks(const std::vector<uint32_t>& tasks, const std::function<void(uint32_t)>& task);
+
+	unsigned int getNumThreads();
+	static unsigned int getDefaultNumThreads();
+
+private:
+	struct WorkQueue
+	{
+		std::mutex mutex;
+		std::deque<uint32_t> tasks;
+	};
+
+	// The thread calling runTasks works too, and uses the first queue.
+	std::vector<std::thread> workers;
+	std::vector<std::unique_ptr<WorkQueue>> queues;
+
+	std::mutex batchMutex;
+	std::condition_variable batchStarted;
+	std::condition_variable batchFinished;
+	const std::function<void(uint32_t)>* currentTask;
+	std::exception_ptr batchError;
+	std::atomic<bool> batchFailed;
+	uint64_t batchNumber;
+	unsigned int busyWorkers;
+	bool stopping;
+
+	void workerLoop(unsigned int queueIndex);
+	void drainQueues(unsigned int queueIndex);
+	bool takeTask(unsigned int queueIndex, uint32_t& task);
+};
+
+#endif
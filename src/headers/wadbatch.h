@@ -0,0 +1,67 @@
+/*
+Copyright (c) 2021, JugadorXEI
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice,
+this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef JUG_WADBATCH_H
+#define JUG_WADBATCH_H
+
+#include <cstdint>
+#include <vector>
+#include <string>
+#include <unordered_set>
+#include <ostream>
+
+#include "commandplan.h"
+
+// Runs the same arguments on a whole bunch of WADs, a few of them at a time.
+// The arguments are only parsed once; what each WAD prints is kept together
+// and printed when it's done, then there's a summary of what went wrong.
+class WadBatch
+{
+public:
+	WadBatch();
+
+	// Targets can be WADs, folders (every .wad in them) or a pattern
+	// with * or ? in the file name part, like maps/*.wad.
+	// Returns false if one of them can't be used at all.
+	bool addTargets(const std::vector<std::string>& targets, std::ostream& out);
+
+	// The arguments are the ones that'd go after the WAD's name.
+	// --jobs is how many threads there are in total: that many WADs go at
+	// once, and if there's fewer WADs than that, they split the rest.
+	// Returns false if the arguments are no good or any WAD failed.
+	bool run(const std::vector<std::string>& arguments, std::ostream& out);
+
+	size_t getNumWADs() const;
+
+private:
+	std::vector<std::string> wadFileNames;
+	std::unordered_set<std::string> wadKeys;
+
+	void addWAD(const std::string& fileName);
+	bool addMatchingWADs(const std::string& target, std::ostream& out);
+	void addFolder(const std::string& folder);
+};
+
+#endif
@@ -30,6 +30,12 @@ EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <vector>
 #include <string>
 #include <string_view>
+#include <memory>
+#include <unordered_map>
+
+#include "mappedfile.h"
+#include "threadpool.h"
+#include "lumparena.h"
 
 enum WadType
 {
@@ -40,12 +46,99 @@ enum WadType
 	CUSTOM	= 3		// Whatever else (SDLL and so)
 };
 
-struct WadFile
+enum ImportMode
+{
+	READ_ALL	= 0,	// Every lump gets read into its own buffer.
+	MAPPED		= 1,	// Lumps point into a memory mapping of the WAD.
+	DIRECTORY_ONLY = 2,	// Only the header and file list, no lumps at all.
+	ARENA		= 3		// The whole file in one allocation, and changed lumps in big blocks.
+};
+
+enum ExportMode
+{
+	REWRITE		= 0,	// Write the whole WAD from scratch.
+	IN_PLACE	= 1		// Only append what changed to the WAD we were read from, if we can.
+};
+
+enum MoveType
+{
+	MOVE_TO		= 0,	// Move a lump to a position.
+	SWAP_WITH	= 1		// Swap a lump with another one.
+};
+
+// One step of a batch of moves, see WadFormat::moveLumps().
+// Lumps are found by name as things stand when the step comes up.
+struct LumpMove
+{
+	MoveType type{ MoveType::MOVE_TO };
+	std::string name{};
+	std::string otherName{};	// Only for SWAP_WITH.
+	int position{ 0 };			// Only for MOVE_TO.
+	bool relative{ false };		// Only for MOVE_TO.
+};
+
+enum SelectType
+{
+	BY_NAME		= 0,	// Every lump with that exact name.
+	BY_INDEX	= 1,	// The lump at that index.
+	BY_PATTERN	= 2		// Every lump the pattern picks out, see LumpPattern.
+};
+
+class LumpPattern;
+
+// Picks out lumps for WadFormat::removeLumps().
+struct LumpSelector
+{
+	SelectType type{ SelectType::BY_NAME };
+	std::string name{};			// Name or pattern.
+	unsigned int index{ 0 };	// Only for BY_INDEX.
+	const LumpPattern* pattern{ nullptr };	// Only for BY_PATTERN.
+};
+
+// Where a marker namespace like F_START/F_END sits in the file list.
+struct MarkerRange
+{
+	int start{ -1 };	// -1 if there's only an _END marker.
+	int end{ -1 };
+};
+
+// A lump's bytes, behind a shared handle. Lumps imported from a mapped WAD
+// point into the mapping, everything else into a block of memory. Copying
+// one only copies the handle, the bytes get copied the first time someone
+// wants to change them.
+struct LumpData
 {
-	uint32_t dataOffset; // this is for informative uses only
-	uint32_t dataSize;
-	std::string name;
-	std::vector<char> binaryData;
+	std::shared_ptr<MappedFile> mappedFile{};
+	const char* mappedData{ nullptr };
+
+	const char* getData();
+	char* getMutableData(uint32_t dataSize);
+	void setData(std::vector<char>&& newData);
+};
+
+class WadFormat;
+
+// View of a single entry of a WadFormat's file list.
+// It's only valid until lumps get added, removed or moved around.
+class WadFile
+{
+public:
+	WadFile(WadFormat& wad, unsigned int index);
+
+	unsigned int	getIndex();
+	std::string		getName();
+	uint64_t		getPackedName();
+	uint32_t		getOffset(); // this is for informative uses only
+	uint32_t		getSize();
+	const char*		getData();
+	LumpData&		getLumpData();
+
+	void setName(std::string_view newName);
+	void setSize(uint32_t newSize);
+
+private:
+	WadFormat*		wad;
+	unsigned int	index;
 };
 
 class WadFormat
@@ -53,6 +146,7 @@ class WadFormat
 public:
 	static const int minSizeForCompression{ 1024 };
 	static const int fileNameLength{ 8 };
+	static const int readBufferSize{ 1 << 20 };
 
 	WadFormat();
 	WadFormat(std::string_view fileName);
@@ -63,44 +157,131 @@ public:
 	WadType 	getWADType();
 	std::string_view getWADTypeToChar();
 	std::string&	getWADName();
-	std::vector<WadFile>& getWADLumpList();
 
-	WadFile& getFileFromIndex(const unsigned int index);
-	WadFile& operator[](const unsigned int index);
+	// Lets (de)compression and such spread lumps over the pool's threads.
+	void setThreadPool(std::shared_ptr<ThreadPool> pool);
+	std::shared_ptr<ThreadPool> getThreadPool();
 
-	bool exportWAD(std::string_view fileName);
-	bool importWAD(std::string_view fileName);
+	// Roughly how many bytes of (de)compressed lumps can be in memory at once,
+	// the rest gets moved out to scratch files. 0 means no limit.
+	void setMaxMemory(uint64_t bytes);
+
+	WadFile getFileFromIndex(const unsigned int index);
+	WadFile operator[](const unsigned int index);
+
+	bool exportWAD(std::string_view fileName, ExportMode mode = ExportMode::REWRITE);
+	bool importWAD(std::string_view fileName, ImportMode mode = ImportMode::MAPPED);
 	
 	bool compressWAD();
-	void compressFile(WadFile& file);
+	void compressFile(WadFile file);
 	bool decompressWAD(WadType newType = WadType::PWAD);
-	void decompressFile(WadFile& file);
+	void decompressFile(WadFile file);
 
 	bool addFileToWAD(std::string_view filename, std::string_view newname = "", bool override = false);
-	void addFileToWAD(WadFile& file);
+	void addFileToWAD(WadFile file);
 	void removeFileByIndex(const unsigned int index);
 	bool removeFileByName(std::string_view filename);
+
+	// Removes everything the selectors pick out in one go. Indices are the ones
+	// from before anything got removed. Returns whether each selector found anything.
+	std::vector<uint8_t> removeLumps(const std::vector<LumpSelector>& selectors);
+	void renameFileByIndex(const unsigned int index, std::string_view newName);
+
+	int findFileByName(std::string_view name);
+	const std::vector<unsigned int>& findFilesByName(std::string_view name);
+	// Every lump each pattern picks out, in order. Exact names come straight from
+	// the name index, the rest get checked together in one go over the file list.
+	std::vector<std::vector<unsigned int>> findLumpsMatching(const std::vector<const LumpPattern*>& patterns);
 	
-	bool extractLump(WadFile& file, bool noExtension = false, std::string_view path = "");
+	bool extractLump(WadFile file, bool noExtension = false, std::string_view path = "");
+	std::vector<uint8_t> extractAllLumps(bool noExtension = false, std::string_view path = "");
 	void createMarkers(std::string_view markerName);
 
+	// Finds the markers for a namespace, F and FF both find F_START/F_END and FF_START/FF_END.
+	bool findMarkerRange(std::string_view markerName, MarkerRange& range);
+	// Moves all of these lumps right above the namespace's _END marker, in the order given,
+	// in one go. newPositions gets where each of them ended up (UINT_MAX if it's not a lump).
+	bool moveLumpsWithin(std::string_view markerName, const std::vector<unsigned int>& indices,
+		std::vector<unsigned int>& newPositions);
+
 	bool swapLumpPosByName(std::string_view name1, std::string_view name2);
 	void swapLumpPosByIndex(unsigned int index1, unsigned int index2);
 
 	bool moveLumpPosByName(std::string_view name1, int position, bool relative);
 	bool moveLumpPosByIndex(unsigned int index, int position, bool relative);
 
+	// Does a whole batch of moves and swaps, with the same result as doing them
+	// one after the other, but only reorders the file list once at the end.
+	// Returns whether each of them could be done.
+	std::vector<uint8_t> moveLumps(const std::vector<LumpMove>& moves);
+
+	static uint64_t packLumpName(std::string_view name);
+	static std::string unpackLumpName(uint64_t packedName);
 	static std::string_view determineFormatFromFileName(std::string_view fileName);
 	static void trimStringToMarkerCharacters(std::string& markerName);
 
 private:
+	friend class WadFile;
+
 	WadType 	wadType;
 	std::string wadName;
 	uint32_t 	wadNumFiles;
 	uint32_t 	wadOffFAT;
-	std::vector<WadFile> wadFiles;
+	bool		lumpDataLoaded;
+	uint64_t	maxMemory;
+
+	// The file list, one entry per lump in each.
+	std::vector<uint64_t> lumpNames;
+	std::vector<uint32_t> lumpOffsets;
+	std::vector<uint32_t> lumpSizes;
+	std::vector<LumpData> lumpData;
+
+	std::shared_ptr<ThreadPool> threadPool;
+
+	// Where changed lumps go when imported with ImportMode::ARENA.
+	std::shared_ptr<LumpArena> lumpArena;
+
+	// The mapped WAD we were imported from, if any.
+	std::shared_ptr<MappedFile> sourceFile;
+
+	// Lump indices by packed name, in order. Names can repeat (THINGS, LINEDEFS...).
+	std::unordered_map<uint64_t, std::vector<unsigned int>> lumpNameIndex;
 
 	void setWADType(WadType newType);
+	bool updateWADInPlace(std::string_view fileName);
+	void writeHeader(char* header, uint32_t FATOffset);
+	std::vector<char> buildDirectory(const std::vector<uint32_t>& dataOffsets);
+	bool writeWAD(FILE* file, const std::vector<uint32_t>& dataOffsets, uint32_t FATOffset, size_t& copiedBytes);
+	void mapLumpsToFile(std::string_view fileName);
+	static FILE* createTempFile(std::string_view fileName, std::string& tempName);
+	static bool writeBuffers(FILE* file, const std::vector<std::string_view>& buffers);
+	static bool finishTempFile(FILE* file, std::string_view tempName, std::string_view fileName);
+	static bool syncFile(FILE* file);
+	bool importMappedWAD(std::shared_ptr<MappedFile>& mapping);
+	bool importBufferedWAD(std::string_view fileName);
+	bool importDirectoryOnly(std::string_view fileName);
+	bool importStreamedWAD(std::string_view fileName, ImportMode mode);
+	bool readStreamedDirectory(FILE* input);
+	void readHeader(const char* header);
+	void readDirectory(const char* directory);
+
+	void appendLump(uint64_t name, uint32_t offset, uint32_t size, LumpData&& data);
+	void clearLumps();
+	uint32_t getEndOfData();
+	void runOnEveryLump(const std::function<void(uint32_t)>& task);
+	void runOnLumps(std::vector<uint32_t>& indices, const std::function<void(uint32_t)>& task);
+	void runOnEveryLumpWithin(const std::function<void(uint32_t)>& task,
+		const std::function<uint64_t(uint32_t)>& outputSize);
+	void spillLumps(std::vector<uint32_t>& indices);
+	void setLumpData(const unsigned int index, std::vector<char>&& newData);
+
+	void indexLump(const unsigned int index);
+	void unindexLump(const unsigned int index);
+	void reindexLump(uint64_t name, const unsigned int oldIndex, const unsigned int newIndex);
+	void rebuildNameIndex();
+	void reorderLumps(const std::vector<uint32_t>& newOrder);
+	void compactLumps(const std::vector<uint8_t>& removed);
+	void unmapLumpsFromFile(std::string_view fileName);
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,78 @@
+/*
+Copyright (c) 2021, JugadorXEI
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice,
+this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef JUG_WADSERVER_H
+#define JUG_WADSERVER_H
+
+#include <cstdint>
+#include <vector>
+#include <string>
+#include <string_view>
+#include <ostream>
+
+#include "wadsession.h"
+
+// Keeps WADs loaded between runs of wadcli. Commands come in over a local
+// (Unix domain) socket as the same arguments wadcli takes, and whatever
+// they'd print goes back the same way.
+// Requests are: the number of strings, then each one as its length and its
+// characters, the client's working directory first. Lengths are 32 bits.
+// Replies are: the exit status, then the length of the output and the output.
+class WadServer
+{
+public:
+	static const size_t defaultMaxWADs{ 8 };
+	static const uint32_t maxRequestStrings{ 1 << 16 };
+	static const uint32_t maxRequestStringSize{ 1 << 20 };
+	// How long a client can keep us waiting on one read or write before it gets dropped.
+	// Clients are answered one at a time, so a stuck one would hold up everybody else.
+	static const int clientTimeoutSeconds{ 10 };
+
+	WadServer(size_t maxWADs = defaultMaxWADs);
+
+	WadServer(const WadServer&) = delete;
+	WadServer& operator=(const WadServer&) = delete;
+
+	// Answers requests until one says --stop. Returns false if it couldn't start.
+	bool serve(std::string_view socketPath, std::ostream& out);
+
+	// Sends the arguments to a server and prints what comes back.
+	// Returns the exit status to use.
+	static int runClient(std::string_view socketPath, const std::vector<std::string>& arguments,
+		std::ostream& out);
+
+private:
+	WadSession session;
+
+	// Returns false once it's been told to stop.
+	bool answerClient(int client);
+
+	static bool readAll(int socket, char* data, size_t size);
+	static bool writeAll(int socket, const char* data, size_t size);
+	static bool readString(int socket, std::string& string, uint32_t maxSize);
+	static bool writeString(int socket, std::string_view string);
+};
+
+#endif
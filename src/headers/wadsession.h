@@ -0,0 +1,108 @@
+/*
+Copyright (c) 2021, JugadorXEI
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice,
+this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef JUG_WADSESSION_H
+#define JUG_WADSESSION_H
+
+#include <cstdint>
+#include <vector>
+#include <string>
+#include <string_view>
+#include <memory>
+#include <filesystem>
+#include <istream>
+#include <ostream>
+
+#include "wadformat.h"
+#include "commandplan.h"
+
+// WADs kept loaded between commands, so a bunch of them only costs
+// one read and one write per WAD. Nothing's written until save().
+class WadSession
+{
+public:
+	WadSession();
+
+	WadSession(const WadSession&) = delete;
+	WadSession& operator=(const WadSession&) = delete;
+
+	// Runs one command line, the WAD's name first, like the arguments to wadcli.
+	bool runCommand(const std::vector<std::string>& arguments, std::ostream& out);
+
+	// Writes every WAD that was changed, or only the one named.
+	bool save(std::ostream& out, std::string_view wadFileName = "");
+
+	// One command per line, and "save" lines to write what's been done so far.
+	// Everything left gets saved at the end, unless a line fails.
+	bool runScript(std::istream& script, std::ostream& out);
+
+	// At most this many WADs stay loaded, the ones used longest ago go first.
+	// 0 means no limit.
+	void setMaxWADs(size_t maxWADs);
+
+	// Every command gets written right after it runs, like wadcli on its own would.
+	// WADs written somewhere else and ones a command failed on are dropped,
+	// so the next command gets them as they are on disk.
+	void setWriteThrough(bool writeThrough);
+
+	// Splits a line into arguments like a shell would: quotes keep spaces,
+	// backslashes escape and # starts a comment.
+	static std::vector<std::string> splitCommandLine(std::string_view line);
+
+private:
+	struct ResidentWAD
+	{
+		std::string key{};			// Full path, so a.wad and ./a.wad are the same WAD.
+		std::string fileName{};
+		std::unique_ptr<WadFormat> wad{};
+		bool changed{ false };
+		bool compact{ false };
+
+		// To tell when something else changed the file.
+		std::filesystem::file_time_type modifiedTime{};
+		uintmax_t fileSize{ 0 };
+		uint64_t lastUsed{ 0 };
+	};
+
+	std::vector<ResidentWAD> wads;
+	std::shared_ptr<ThreadPool> threadPool;
+	size_t maxWADs;
+	bool writingThrough;
+	uint64_t useCounter;
+
+	ResidentWAD* loadWAD(const CommandPlan& plan, std::ostream& out);
+	ResidentWAD* findWAD(std::string_view fileName);
+	ResidentWAD* replaceWAD(const std::string& key, std::string_view fileName,
+		std::unique_ptr<WadFormat> wad, std::ostream& out);
+	bool saveWAD(ResidentWAD& resident, std::ostream& out);
+	void forgetWAD(ResidentWAD& resident);
+	bool makeRoom(std::ostream& out);
+	bool isOutdated(const ResidentWAD& resident);
+	void rememberFileState(ResidentWAD& resident);
+
+	static std::string getKeyForFileName(std::string_view fileName);
+};
+
+#endif
@@ -0,0 +1,76 @@
+/*
+Copyright (c) 2021, JugadorXEI
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice,
+this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <cstring>
+#include <algorithm>
+#include "headers/lumparena.h"
+
+LumpArena::LumpArena(size_t newBlockSize)
+	: mutex{}, currentBlock{}, used{ 0 }, blockSize{ newBlockSize }, numBlocks{ 0 }, numStored{ 0 }
+{
+	// empty.
+}
+
+const char* LumpArena::store(const char* data, size_t dataSize, std::shared_ptr<MappedFile>& block)
+{
+	char* destination{ nullptr };
+
+	{
+		std::lock_guard<std::mutex> lock{ mutex };
+
+		// Whatever's left of a full block just goes unused.
+		if (currentBlock == nullptr || used + dataSize > (*currentBlock).getSize())
+		{
+			std::shared_ptr<MappedFile> newBlock{ std::make_shared<MappedFile>() };
+			if (!(*newBlock).allocate(std::max(blockSize, dataSize)))
+				return nullptr;
+
+			currentBlock = std::move(newBlock);
+			used = 0;
+			++numBlocks;
+		}
+
+		destination = (*currentBlock).getWritableData() + used;
+		used += dataSize;
+		++numStored;
+		block = currentBlock;
+	}
+
+	// The room is ours now, no need to hold everyone else up while copying.
+	std::memcpy(destination, data, dataSize);
+	return destination;
+}
+
+size_t LumpArena::getNumBlocks()
+{
+	std::lock_guard<std::mutex> lock{ mutex };
+	return numBlocks;
+}
+
+size_t LumpArena::getNumStored()
+{
+	std::lock_guard<std::mutex> lock{ mutex };
+	return numStored;
+}
@@ -0,0 +1,338 @@
+/*
+Copyright (c) 2021, JugadorXEI
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice,
+this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <cstring>
+#include <cctype>
+#include <cstdlib>
+#include "headers/lumppattern.h"
+#include "headers/wadformat.h"
+
+LumpPattern::LumpPattern()
+	: text{}, nameMatch{ NameMatch::ANY_NAME }, name{}, nameRegex{}, nameMask{ 0 }, nameValue{ 0 }, maskDecides{ true }, tooLong{ false },
+	indexRange{ false }, firstIndex{ 0 }, lastIndex{ 0 }, scopeStart{}, scopeEnd{}
+{
+	// empty.
+}
+
+bool LumpPattern::compile(std::string_view pattern, std::string& error)
+{
+	(*this) = LumpPattern{};
+	text = pattern;
+
+	if (pattern.empty())
+	{
+		error = "an empty pattern matches nothing";
+		return false;
+	}
+
+	// ?num or ?num-num, then maybe :name. Anything else starting
+	// with ? is just a glob, like ?_START.
+	if (pattern.size() > 1 && pattern[0] == '?' && std::isdigit(static_cast<unsigned char>(pattern[1])))
+	{
+		char* numberEnd{ nullptr };
+		const unsigned long first{ std::strtoul(text.c_str() + 1, &numberEnd, 10) };
+		unsigned long last{ first };
+		if (*numberEnd == '-' && std::isdigit(static_cast<unsigned char>(numberEnd[1])))
+			last = std::strtoul(numberEnd + 1, &numberEnd, 10);
+
+		if (*numberEnd == '\0' || *numberEnd == ':')
+		{
+			if (first == 0 || last < first || last > UINT32_MAX)
+			{
+				error = "positions count from 1, and ranges go from the lower one to the higher one";
+				return false;
+			}
+
+			indexRange = true;
+			firstIndex = static_cast<unsigned int>(first - 1);
+			lastIndex = static_cast<unsigned int>(last - 1);
+
+			if (*numberEnd == '\0')
+				return true;
+
+			return (*this).compileName(numberEnd + 1, error);
+		}
+	}
+
+	// FROM..TO, then maybe :name. Regular expressions can have .. in them, so not those.
+	if (size_t dots = pattern.find(".."); pattern[0] != '~' && dots != std::string_view::npos)
+	{
+		const size_t colon{ pattern.find(':', dots + 2) };
+		scopeStart = pattern.substr(0, dots);
+		scopeEnd = pattern.substr(dots + 2, colon == std::string_view::npos ? colon : colon - dots - 2);
+
+		if (scopeStart.empty() || scopeEnd.empty() ||
+			scopeStart.find_first_of("*?") != std::string::npos ||
+			scopeEnd.find_first_of("*?") != std::string::npos)
+		{
+			error = "both ends of FROM..TO have to be lump names";
+			return false;
+		}
+
+		if (colon == std::string_view::npos)
+			return true;
+
+		return (*this).compileName(pattern.substr(colon + 1), error);
+	}
+
+	return (*this).compileName(pattern, error);
+}
+
+bool LumpPattern::compileName(std::string_view namePattern, std::string& error)
+{
+	if (namePattern.empty())
+	{
+		error = "there's nothing after the :";
+		return false;
+	}
+
+	if (namePattern[0] == '~')
+	{
+		// Patterns are compiled before anything is done, so this is the only place a bad one shows up.
+		try
+		{
+			nameRegex = std::regex{ std::string{ namePattern.substr(1) },
+				std::regex::ECMAScript | std::regex::optimize };
+		}
+		catch (const std::regex_error& regexError)
+		{
+			error = std::string{ "bad regular expression: " } + regexError.what();
+			return false;
+		}
+
+		nameMatch = NameMatch::REGEX_NAME;
+		name = namePattern.substr(1);
+		maskDecides = false;
+		return true;
+	}
+
+	name = namePattern;
+	nameMatch = name.find_first_of("*?") == std::string::npos ? NameMatch::EXACT_NAME : NameMatch::GLOB_NAME;
+
+	// Every character before the first * has to be right where it is. ? can be
+	// anything, so it's left out. Without a *, the name has to end right there too,
+	// and a packed name ends with a 0.
+	const size_t nameSize{ sizeof(uint64_t) };
+	const size_t star{ name.find('*') };
+	unsigned char mask[nameSize]{};
+	unsigned char bytes[nameSize]{};
+
+	size_t at{ 0 };
+	for (; at < name.size() && at < nameSize && name[at] != '*'; ++at)
+	{
+		if (name[at] == '?')
+			continue;
+
+		mask[at] = 0xFF;
+		bytes[at] = static_cast<unsigned char>(name[at]);
+	}
+
+	if (at == name.size() && at < nameSize)
+		mask[at] = 0xFF;
+
+	// Without a *, a pattern longer than a lump name can't match anything. Cutting it
+	// down would make TEXTURE1X find TEXTURE1.
+	tooLong = star == std::string::npos && name.size() > nameSize;
+
+	std::memcpy(&nameMask, mask, sizeof(nameMask));
+	std::memcpy(&nameValue, bytes, sizeof(nameValue));
+
+	// Exact names, and names with a single * on the end (as long as what's before
+	// it fits), don't need anything else. ? still has to check that there's a character.
+	maskDecides = name.find('?') == std::string::npos &&
+		((star == std::string::npos && name.size() <= nameSize) ||
+		(star == name.size() - 1 && star <= nameSize));
+
+	return true;
+}
+
+bool LumpPattern::matchesName(uint64_t packedName) const
+{
+	if (tooLong || (packedName & nameMask) != nameValue)
+		return false;
+
+	if (maskDecides)
+		return true;
+
+	char lumpName[sizeof(uint64_t)];
+	std::memcpy(lumpName, &packedName, sizeof(lumpName));
+	const std::string_view nameView{ lumpName, strnlen(lumpName, sizeof(lumpName)) };
+
+	switch (nameMatch)
+	{
+		case NameMatch::ANY_NAME:
+		case NameMatch::EXACT_NAME:
+			return true;
+		case NameMatch::GLOB_NAME:
+			return LumpPattern::matchesGlob(nameView, name);
+		case NameMatch::REGEX_NAME:
+			return std::regex_match(nameView.begin(), nameView.end(), nameRegex);
+	}
+
+	return false;
+}
+
+bool LumpPattern::matchCaptures(std::string_view lumpName, std::vector<std::string>& captures) const
+{
+	captures.clear();
+	captures.emplace_back(lumpName);
+
+	switch (nameMatch)
+	{
+		case NameMatch::ANY_NAME:
+			return true;
+		case NameMatch::EXACT_NAME:
+			return !tooLong && lumpName == name;
+		case NameMatch::GLOB_NAME:
+			return LumpPattern::matchesGlob(lumpName, name, &captures);
+		case NameMatch::REGEX_NAME:
+		{
+			std::match_results<std::string_view::const_iterator> groups{};
+			if (!std::regex_match(lumpName.begin(), lumpName.end(), groups, nameRegex))
+				return false;
+
+			for (size_t i = 1; i < groups.size(); ++i)
+				captures.push_back(groups[i].str());
+
+			return true;
+		}
+	}
+
+	return false;
+}
+
+std::string LumpPattern::fillTemplate(std::string_view nameTemplate, const std::vector<std::string>& captures)
+{
+	std::string filled{};
+	for (size_t i = 0; i < nameTemplate.size(); ++i)
+	{
+		if (nameTemplate[i] != '$' || i + 1 == nameTemplate.size())
+		{
+			filled += nameTemplate[i];
+			continue;
+		}
+
+		const char next{ nameTemplate[++i] };
+		if (next == '$')
+			filled += '$';
+		else if (std::isdigit(static_cast<unsigned char>(next)))
+		{
+			const size_t capture{ static_cast<size_t>(next - '0') };
+			if (capture < captures.size())
+				filled += captures[capture];
+		}
+		else
+		{
+			filled += '$';
+			filled += next;
+		}
+	}
+
+	return filled;
+}
+
+bool LumpPattern::matchesGlob(std::string_view lumpName, std::string_view glob, std::vector<std::string>* captures)
+{
+	if (captures == nullptr)
+	{
+		// * matches any number of characters, ? any one, everything else has to be
+		// the same. When a * fails further on, give it one more character and try again.
+		size_t nameAt{ 0 }, globAt{ 0 };
+		size_t starAt{ std::string_view::npos }, starNameAt{ 0 };
+
+		while (nameAt < lumpName.size())
+		{
+			if (globAt < glob.size() && glob[globAt] == '*')
+			{
+				starAt = globAt++;
+				starNameAt = nameAt;
+			}
+			else if (globAt < glob.size() && (glob[globAt] == '?' || glob[globAt] == lumpName[nameAt]))
+			{
+				globAt++;
+				nameAt++;
+			}
+			else if (starAt != std::string_view::npos)
+			{
+				globAt = starAt + 1;
+				nameAt = ++starNameAt;
+			}
+			else
+				return false;
+		}
+
+		while (globAt < glob.size() && glob[globAt] == '*')
+			globAt++;
+
+		return globAt == glob.size();
+	}
+
+	// Keeping what every wildcard matched means trying every split, but lump names
+	// are 8 characters at most. Each * takes as much as it can, like .* would.
+	if (glob.empty())
+		return lumpName.empty();
+
+	if (glob[0] == '*')
+	{
+		for (size_t taken = lumpName.size() + 1; taken-- > 0;)
+		{
+			(*captures).emplace_back(lumpName.substr(0, taken));
+			if (LumpPattern::matchesGlob(lumpName.substr(taken), glob.substr(1), captures))
+				return true;
+			(*captures).pop_back();
+		}
+
+		return false;
+	}
+
+	if (lumpName.empty() || (glob[0] != '?' && glob[0] != lumpName[0]))
+		return false;
+
+	if (glob[0] == '?')
+		(*captures).emplace_back(lumpName.substr(0, 1));
+
+	if (LumpPattern::matchesGlob(lumpName.substr(1), glob.substr(1), captures))
+		return true;
+
+	if (glob[0] == '?')
+		(*captures).pop_back();
+
+	return false;
+}
+
+const std::string& LumpPattern::getText() const { return text; }
+bool LumpPattern::isExactName() const { return nameMatch == NameMatch::EXACT_NAME && !indexRange && scopeStart.empty(); }
+bool LumpPattern::isSingleIndex() const { return indexRange && firstIndex == lastIndex && nameMatch == NameMatch::ANY_NAME; }
+bool LumpPattern::hasIndexRange() const { return indexRange; }
+unsigned int LumpPattern::getFirstIndex() const { return firstIndex; }
+unsigned int LumpPattern::getLastIndex() const { return lastIndex; }
+bool LumpPattern::hasScope() const { return !scopeStart.empty(); }
+const std::string& LumpPattern::getScopeStart() const { return scopeStart; }
+const std::string& LumpPattern::getScopeEnd() const { return scopeEnd; }
+const std::string& LumpPattern::getName() const { return name; }
+uint64_t LumpPattern::getNameMask() const { return nameMask; }
+uint64_t LumpPattern::getNameValue() const { return nameValue; }
+bool LumpPattern::isDecidedByMask() const { return maskDecides; }
+bool LumpPattern::canMatch() const { return !tooLong; }
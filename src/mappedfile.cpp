@@ -0,0 +1,401 @@
+/*
+Copyright (c) 2021, JugadorXEI
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice,
+this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <algorithm>
+#include <cstdint>
+#include <new>
+#include <filesystem>
+#ifdef _WIN32
+#include <windows.h>
+#include <io.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#ifdef __linux__
+#include <sys/sendfile.h>
+#endif
+
+#include "headers/mappedfile.h"
+
+MappedFile::MappedFile()
+	: fileName{}, data{ nullptr }, size{ 0 }, memory{},
+#ifdef _WIN32
+	fileHandle{ INVALID_HANDLE_VALUE }, mappingHandle{ nullptr }
+#else
+	fileDescriptor{ -1 }
+#endif
+{
+	// empty.
+}
+
+MappedFile::~MappedFile()
+{
+	(*this).closeFile();
+}
+
+#ifdef _WIN32
+bool MappedFile::openFile(std::string_view newFileName)
+{
+	(*this).closeFile();
+	fileName = newFileName;
+
+	// Shared for writing too, so changes can be appended to a mapped WAD.
+	fileHandle = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr,
+		OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+	if (fileHandle == INVALID_HANDLE_VALUE)
+		return false;
+
+	return (*this).mapFile();
+}
+
+bool MappedFile::mapFile()
+{
+	LARGE_INTEGER fileSize{};
+	if (!GetFileSizeEx(fileHandle, &fileSize) || fileSize.QuadPart == 0)
+	{
+		(*this).closeFile();
+		return false;
+	}
+
+	size = static_cast<size_t>(fileSize.QuadPart);
+
+	mappingHandle = CreateFileMappingA(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (mappingHandle == nullptr)
+	{
+		(*this).closeFile();
+		return false;
+	}
+
+	data = static_cast<const char*>(MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0));
+	if (data == nullptr)
+	{
+		(*this).closeFile();
+		return false;
+	}
+
+	return true;
+}
+
+void MappedFile::closeFile()
+{
+	// Memory blocks have nothing to unmap.
+	if (!memory.empty())
+	{
+		memory = std::vector<char>{};
+		data = nullptr;
+	}
+
+	if (data != nullptr)
+		UnmapViewOfFile(data);
+
+	if (mappingHandle != nullptr)
+		CloseHandle(mappingHandle);
+
+	if (fileHandle != INVALID_HANDLE_VALUE)
+		CloseHandle(fileHandle);
+
+	data			= nullptr;
+	size			= 0;
+	mappingHandle	= nullptr;
+	fileHandle		= INVALID_HANDLE_VALUE;
+}
+#else
+bool MappedFile::openFile(std::string_view newFileName)
+{
+	(*this).closeFile();
+	fileName = newFileName;
+
+	fileDescriptor = open(fileName.c_str(), O_RDONLY);
+	if (fileDescriptor == -1)
+		return false;
+
+	return (*this).mapFile();
+}
+
+bool MappedFile::mapFile()
+{
+	struct stat fileStatus{};
+	if (fstat(fileDescriptor, &fileStatus) != 0 || fileStatus.st_size <= 0)
+	{
+		// mmap can't map empty files, so don't even try.
+		(*this).closeFile();
+		return false;
+	}
+
+	size = static_cast<size_t>(fileStatus.st_size);
+
+	void* mapping = mmap(nullptr, size, PROT_READ, MAP_SHARED, fileDescriptor, 0);
+	if (mapping == MAP_FAILED)
+	{
+		(*this).closeFile();
+		return false;
+	}
+
+	data = static_cast<const char*>(mapping);
+	return true;
+}
+
+void MappedFile::closeFile()
+{
+	// Memory blocks have nothing to unmap.
+	if (!memory.empty())
+	{
+		memory = std::vector<char>{};
+		data = nullptr;
+	}
+
+	if (data != nullptr)
+		munmap(const_cast<char*>(data), size);
+
+	if (fileDescriptor != -1)
+		close(fileDescriptor);
+
+	data			= nullptr;
+	size			= 0;
+	fileDescriptor	= -1;
+}
+#endif
+
+bool MappedFile::openStream(FILE* input)
+{
+	(*this).closeFile();
+	fileName.clear();
+
+	// Gets deleted by itself once the last handle to it goes away.
+	FILE* spool{ std::tmpfile() };
+	if (spool == nullptr)
+		return false;
+
+	std::vector<char> buffer{};
+	buffer.resize(1 << 20);
+
+	size_t readBytes{ 0 };
+	bool spooled{ true };
+	while (spooled && (readBytes = std::fread(buffer.data(), sizeof(char), buffer.size(), input)) > 0)
+		spooled = std::fwrite(buffer.data(), sizeof(char), readBytes, spool) == readBytes;
+
+	if (!spooled || std::ferror(input) != 0)
+	{
+		std::fclose(spool);
+		return false;
+	}
+
+	return (*this).mapSpool(spool);
+}
+
+bool MappedFile::openBuffers(const std::vector<std::string_view>& buffers)
+{
+	(*this).closeFile();
+	fileName.clear();
+
+	FILE* spool{ std::tmpfile() };
+	if (spool == nullptr)
+		return false;
+
+	for (const std::string_view& buffer : buffers)
+	{
+		if (std::fwrite(buffer.data(), sizeof(char), buffer.size(), spool) != buffer.size())
+		{
+			std::fclose(spool);
+			return false;
+		}
+	}
+
+	return (*this).mapSpool(spool);
+}
+
+bool MappedFile::readFile(std::string_view newFileName)
+{
+	(*this).closeFile();
+	fileName = newFileName;
+
+	FILE* file{ std::fopen(fileName.c_str(), "rb") };
+	if (file == nullptr)
+		return false;
+
+	std::error_code error;
+	const uintmax_t fileSize{ std::filesystem::file_size(fileName, error) };
+
+	bool read{ !error && fileSize > 0 && fileSize <= SIZE_MAX && (*this).allocate(static_cast<size_t>(fileSize)) };
+	fileName = newFileName; // allocate() forgets it.
+
+	read = read && std::fread(memory.data(), sizeof(char), size, file) == size;
+	std::fclose(file);
+
+	if (!read)
+		(*this).closeFile();
+
+	return read;
+}
+
+bool MappedFile::allocate(size_t newSize)
+{
+	(*this).closeFile();
+	fileName.clear();
+
+	if (newSize == 0)
+		return false;
+
+	try
+	{
+		memory.resize(newSize);
+	}
+	catch (const std::bad_alloc&)
+	{
+		return false;
+	}
+
+	data = memory.data();
+	size = newSize;
+	return true;
+}
+
+bool MappedFile::adopt(std::vector<char>&& buffer)
+{
+	(*this).closeFile();
+	fileName.clear();
+
+	if (buffer.empty())
+		return false;
+
+	memory = std::move(buffer);
+	data = memory.data();
+	size = memory.size();
+	return true;
+}
+
+bool MappedFile::mapSpool(FILE* spool)
+{
+	bool spooled{ std::fflush(spool) == 0 };
+
+	// Hold on to our own handle of it, the FILE can go.
+	if (spooled)
+	{
+#ifdef _WIN32
+		HANDLE spoolHandle{ reinterpret_cast<HANDLE>(_get_osfhandle(_fileno(spool))) };
+		HANDLE process{ GetCurrentProcess() };
+		if (!DuplicateHandle(process, spoolHandle, process, &fileHandle, 0, FALSE, DUPLICATE_SAME_ACCESS))
+			fileHandle = INVALID_HANDLE_VALUE;
+
+		spooled = fileHandle != INVALID_HANDLE_VALUE;
+#else
+		fileDescriptor = dup(fileno(spool));
+		spooled = fileDescriptor != -1;
+#endif
+	}
+
+	std::fclose(spool);
+	return spooled && (*this).mapFile();
+}
+
+#ifdef __linux__
+size_t MappedFile::copyRangeTo(FILE* outFile, size_t offset, size_t length)
+{
+	if (fileDescriptor == -1 || offset > size || length > size - offset)
+		return 0;
+
+	// Whatever stdio is holding on to has to hit the file first.
+	if (std::fflush(outFile) != 0)
+		return 0;
+
+	const int outDescriptor{ fileno(outFile) };
+	size_t copied{ 0 };
+
+	// copy_file_range can share the blocks on filesystems that support it,
+	// sendfile is there for the kernels or filesystem pairs that don't.
+	bool useSendFile{ false };
+	while (copied < length)
+	{
+		loff_t inOffset{ static_cast<loff_t>(offset + copied) };
+		ssize_t result{ -1 };
+
+		if (!useSendFile)
+		{
+			result = copy_file_range(fileDescriptor, &inOffset, outDescriptor, nullptr, length - copied, 0);
+			if (result == -1)
+			{
+				useSendFile = true;
+				continue;
+			}
+		}
+		else
+		{
+			off_t sendOffset{ static_cast<off_t>(offset + copied) };
+			result = sendfile(outDescriptor, fileDescriptor, &sendOffset, length - copied);
+		}
+
+		if (result <= 0)
+			break;
+
+		copied += static_cast<size_t>(result);
+	}
+
+	// The kernel moved the file offset behind stdio's back, so catch it up.
+	const off_t endPosition{ lseek(outDescriptor, 0, SEEK_CUR) };
+	if (endPosition != -1)
+		fseeko(outFile, endPosition, SEEK_SET);
+
+	return copied;
+}
+#else
+size_t MappedFile::copyRangeTo(FILE*, size_t, size_t)
+{
+	// No kernel side copying here, the caller writes it all out.
+	return 0;
+}
+#endif
+
+#ifdef _WIN32
+void MappedFile::releaseRange(const char*, size_t)
+{
+	// Windows trims these by itself when it needs the memory.
+}
+#else
+void MappedFile::releaseRange(const char* start, size_t length)
+{
+	// Throwing away pages of a memory block would throw away what's in them.
+	if (!memory.empty() || data == nullptr || start < data || start >= data + size)
+		return;
+
+	// madvise wants whole pages, so only the ones completely inside go.
+	const uintptr_t pageSize{ static_cast<uintptr_t>(sysconf(_SC_PAGESIZE)) };
+	const uintptr_t first{ (reinterpret_cast<uintptr_t>(start) + pageSize - 1) & ~(pageSize - 1) };
+	const uintptr_t last{ reinterpret_cast<uintptr_t>(start + std::min(length,
+		static_cast<size_t>(data + size - start))) & ~(pageSize - 1) };
+
+	if (last > first)
+		madvise(reinterpret_cast<void*>(first), last - first, MADV_DONTNEED);
+}
+#endif
+
+const char*		MappedFile::getData()		{ return data; }
+char*			MappedFile::getWritableData()	{ return memory.empty() ? nullptr : memory.data(); }
+bool			MappedFile::isInMemory()		{ return !memory.empty(); }
+size_t			MappedFile::getSize()		{ return size; }
+std::string&	MappedFile::getFileName()	{ return fileName; }
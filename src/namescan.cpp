@@ -0,0 +1,169 @@
+/*
+Copyright (c) 2021, JugadorXEI
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice,
+this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "headers/namescan.h"
+
+// The vector versions need x86 and a compiler that can build them
+// without -mavx2 for the whole file, so the rest still runs anywhere.
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+	#define JUG_NAMESCAN_X86 1
+	#include <immintrin.h>
+#else
+	#define JUG_NAMESCAN_X86 0
+#endif
+
+void NameScan::findMatching(const uint64_t* names, uint32_t first, uint32_t last,
+	uint64_t mask, uint64_t value, std::vector<unsigned int>& found)
+{
+	if (first >= last)
+		return;
+
+	// Nothing to compare, everything matches.
+	if (mask == 0)
+	{
+		for (uint32_t i = first; i < last; ++i)
+			found.push_back(i);
+		return;
+	}
+
+	NameScan::getKernel().kernel(names, first, last, mask, value, found);
+}
+
+const char* NameScan::getKernelName() { return NameScan::getKernel().name; }
+
+const NameScan::KernelChoice& NameScan::getKernel()
+{
+	// Worked out the first time it's needed, then never again.
+	static const KernelChoice choice{ []() -> KernelChoice
+	{
+#if JUG_NAMESCAN_X86
+		__builtin_cpu_init();
+		if (__builtin_cpu_supports("avx2"))
+			return { &NameScan::findMatchingAVX2, "AVX2" };
+		// Unoptimized, the intrinsics don't get inlined, and two names
+		// at a time aren't enough to make up for it. Four are. The
+		// makefile always optimizes this file, so this is for other builds.
+	#if defined(__OPTIMIZE__)
+		if (__builtin_cpu_supports("sse2"))
+			return { &NameScan::findMatchingSSE2, "SSE2" };
+	#endif
+#endif
+		return { &NameScan::findMatchingScalar, "scalar" };
+	}() };
+
+	return choice;
+}
+
+void NameScan::findMatchingScalar(const uint64_t* names, uint32_t first, uint32_t last,
+	uint64_t mask, uint64_t value, std::vector<unsigned int>& found)
+{
+	for (uint32_t i = first; i < last; ++i)
+	{
+		if ((names[i] & mask) == value)
+			found.push_back(i);
+	}
+}
+
+#if JUG_NAMESCAN_X86
+
+__attribute__((target("sse2")))
+void NameScan::findMatchingSSE2(const uint64_t* names, uint32_t first, uint32_t last,
+	uint64_t mask, uint64_t value, std::vector<unsigned int>& found)
+{
+	// SSE2 can only compare 32 bits at a time, so a name matches when both of
+	// its halves do: each half gets ANDed with the other one, swapped over.
+	const __m128i masks{ _mm_set1_epi64x(static_cast<long long>(mask)) };
+	const __m128i values{ _mm_set1_epi64x(static_cast<long long>(value)) };
+
+	uint32_t i{ first };
+	for (; last - i >= 4; i += 4)
+	{
+		__m128i low{ _mm_cmpeq_epi32(_mm_and_si128(
+			_mm_loadu_si128(reinterpret_cast<const __m128i*>(names + i)), masks), values) };
+		__m128i high{ _mm_cmpeq_epi32(_mm_and_si128(
+			_mm_loadu_si128(reinterpret_cast<const __m128i*>(names + i + 2)), masks), values) };
+
+		low = _mm_and_si128(low, _mm_shuffle_epi32(low, _MM_SHUFFLE(2, 3, 0, 1)));
+		high = _mm_and_si128(high, _mm_shuffle_epi32(high, _MM_SHUFFLE(2, 3, 0, 1)));
+
+		// One bit per name, from the top bit of each 64-bit half.
+		unsigned int hits{ static_cast<unsigned int>(_mm_movemask_pd(_mm_castsi128_pd(low)) |
+			(_mm_movemask_pd(_mm_castsi128_pd(high)) << 2)) };
+		while (hits != 0)
+		{
+			found.push_back(i + static_cast<uint32_t>(__builtin_ctz(hits)));
+			hits &= hits - 1;
+		}
+	}
+
+	NameScan::findMatchingScalar(names, i, last, mask, value, found);
+}
+
+__attribute__((target("avx2")))
+void NameScan::findMatchingAVX2(const uint64_t* names, uint32_t first, uint32_t last,
+	uint64_t mask, uint64_t value, std::vector<unsigned int>& found)
+{
+	const __m256i masks{ _mm256_set1_epi64x(static_cast<long long>(mask)) };
+	const __m256i values{ _mm256_set1_epi64x(static_cast<long long>(value)) };
+
+	uint32_t i{ first };
+	for (; last - i >= 8; i += 8)
+	{
+		const __m256i low{ _mm256_loadu_si256(reinterpret_cast<const __m256i*>(names + i)) };
+		const __m256i high{ _mm256_loadu_si256(reinterpret_cast<const __m256i*>(names + i + 4)) };
+
+		// One bit per name, from the top bit of each 64-bit compare.
+		const unsigned int lowHits{ static_cast<unsigned int>(_mm256_movemask_pd(
+			_mm256_castsi256_pd(_mm256_cmpeq_epi64(_mm256_and_si256(low, masks), values)))) };
+		const unsigned int highHits{ static_cast<unsigned int>(_mm256_movemask_pd(
+			_mm256_castsi256_pd(_mm256_cmpeq_epi64(_mm256_and_si256(high, masks), values)))) };
+
+		unsigned int hits{ lowHits | (highHits << 4) };
+		while (hits != 0)
+		{
+			found.push_back(i + static_cast<uint32_t>(__builtin_ctz(hits)));
+			hits &= hits - 1;
+		}
+	}
+
+	NameScan::findMatchingScalar(names, i, last, mask, value, found);
+}
+
+#else
+
+// No vectors here, but the dispatch never picks these anyway.
+void NameScan::findMatchingSSE2(const uint64_t* names, uint32_t first, uint32_t last,
+	uint64_t mask, uint64_t value, std::vector<unsigned int>& found)
+{
+	NameScan::findMatchingScalar(names, first, last, mask, value, found);
+}
+
+void NameScan::findMatchingAVX2(const uint64_t* names, uint32_t first, uint32_t last,
+	uint64_t mask, uint64_t value, std::vector<unsigned int>& found)
+{
+	NameScan::findMatchingScalar(names, first, last, mask, value, found);
+}
+
+#endif
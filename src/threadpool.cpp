@@ -0,0 +1,183 @@
+/*
+Copyright (c) 2021, JugadorXEI
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice,
+this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "headers/threadpool.h"
+
+#include <cassert>
+
+ThreadPool::ThreadPool(unsigned int numThreads)
+	: workers{}, queues{}, currentTask{ nullptr }, batchError{}, batchFailed{ false }, batchNumber{ 0 }, busyWorkers{ 0 }, stopping{ false }
+{
+	if (numThreads == 0)
+		numThreads = 1;
+
+	for (unsigned int i = 0; i < numThreads; ++i)
+		queues.push_back(std::make_unique<WorkQueue>());
+
+	// One less, the calling thread makes up for it.
+	for (unsigned int i = 1; i < numThreads; ++i)
+		workers.emplace_back(&ThreadPool::workerLoop, this, i);
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock{ batchMutex };
+		stopping = true;
+	}
+
+	batchStarted.notify_all();
+	for (std::thread& worker : workers)
+		worker.join();
+}
+
+void ThreadPool::runTasks(const std::vector<uint32_t>& tasks, const std::function<void(uint32_t)>& task)
+{
+	if (tasks.empty())
+		return;
+
+	{
+		// A task running tasks would wait on workers that are busy running it.
+		std::lock_guard<std::mutex> lock{ batchMutex };
+		assert(currentTask == nullptr && "ThreadPool::runTasks can't be nested");
+		currentTask = &task;
+		batchFailed = false;
+	}
+
+	// Deal the tasks out like cards, so every queue starts
+	// with a fair share of the slow ones at the front.
+	for (size_t i = 0; i < tasks.size(); ++i)
+		(*queues[i % queues.size()]).tasks.push_back(tasks[i]);
+
+	{
+		std::lock_guard<std::mutex> lock{ batchMutex };
+		busyWorkers = static_cast<unsigned int>(workers.size());
+		++batchNumber;
+	}
+
+	batchStarted.notify_all();
+	(*this).drainQueues(0);
+
+	std::unique_lock<std::mutex> lock{ batchMutex };
+	batchFinished.wait(lock, [this] { return busyWorkers == 0; });
+	currentTask = nullptr;
+
+	// Thrown here, where whoever asked for the tasks can do something about it.
+	if (batchError)
+	{
+		std::exception_ptr error{ batchError };
+		batchError = nullptr;
+		lock.unlock();
+		std::rethrow_exception(error);
+	}
+}
+
+void ThreadPool::workerLoop(unsigned int queueIndex)
+{
+	uint64_t lastBatch{ 0 };
+
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock{ batchMutex };
+			batchStarted.wait(lock, [this, lastBatch] { return stopping || batchNumber != lastBatch; });
+
+			if (stopping)
+				return;
+
+			lastBatch = batchNumber;
+		}
+
+		(*this).drainQueues(queueIndex);
+
+		{
+			std::lock_guard<std::mutex> lock{ batchMutex };
+			--busyWorkers;
+		}
+
+		batchFinished.notify_all();
+	}
+}
+
+void ThreadPool::drainQueues(unsigned int queueIndex)
+{
+	uint32_t task{ 0 };
+	while ((*this).takeTask(queueIndex, task))
+	{
+		// Once one's failed, the rest only get taken off the queues.
+		if (batchFailed)
+			continue;
+
+		try
+		{
+			(*currentTask)(task);
+		}
+		catch (...)
+		{
+			std::lock_guard<std::mutex> lock{ batchMutex };
+			if (!batchError)
+				batchError = std::current_exception();
+			batchFailed = true;
+		}
+	}
+}
+
+bool ThreadPool::takeTask(unsigned int queueIndex, uint32_t& task)
+{
+	// Our own queue first, slowest tasks first...
+	{
+		WorkQueue& ownQueue{ *queues[queueIndex] };
+		std::lock_guard<std::mutex> lock{ ownQueue.mutex };
+		if (!ownQueue.tasks.empty())
+		{
+			task = ownQueue.tasks.front();
+			ownQueue.tasks.pop_front();
+			return true;
+		}
+	}
+
+	// ...then the quickest ones from the back of everyone else's.
+	for (size_t i = 1; i < queues.size(); ++i)
+	{
+		WorkQueue& otherQueue{ *queues[(queueIndex + i) % queues.size()] };
+		std::lock_guard<std::mutex> lock{ otherQueue.mutex };
+		if (!otherQueue.tasks.empty())
+		{
+			task = otherQueue.tasks.back();
+			otherQueue.tasks.pop_back();
+			return true;
+		}
+	}
+
+	return false;
+}
+
+unsigned int ThreadPool::getNumThreads() { return static_cast<unsigned int>(queues.size()); }
+
+unsigned int ThreadPool::getDefaultNumThreads()
+{
+	const unsigned int numThreads{ std::thread::hardware_concurrency() };
+	return numThreads == 0 ? 1 : numThreads;
+}
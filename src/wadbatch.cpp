@@ -0,0 +1,212 @@
+/*
+Copyright (c) 2021, JugadorXEI
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice,
+this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <filesystem>
+#include <string>
+#include <sstream>
+#include <algorithm>
+#include <numeric>
+#include <mutex>
+#include <cctype>
+#include "headers/wadbatch.h"
+#include "headers/lumppattern.h"
+
+WadBatch::WadBatch()
+	: wadFileNames{}, wadKeys{}
+{
+	// empty.
+}
+
+bool WadBatch::addTargets(const std::vector<std::string>& targets, std::ostream& out)
+{
+	for (const std::string& target : targets)
+	{
+		if (target == "-")
+		{
+			out << "WADCLI: The standard input can only be read once, it can't be one of many WADs.\n";
+			return false;
+		}
+
+		std::error_code error;
+		if (target.find_first_of("*?") != std::string::npos)
+		{
+			if (!(*this).addMatchingWADs(target, out))
+				return false;
+		}
+		else if (std::filesystem::is_directory(target, error))
+			(*this).addFolder(target);
+		else
+			(*this).addWAD(target);
+	}
+
+	return true;
+}
+
+bool WadBatch::run(const std::vector<std::string>& arguments, std::ostream& out)
+{
+	if (wadFileNames.empty())
+	{
+		out << "WADCLI: There are no WADs to work on.\n";
+		return false;
+	}
+
+	// Parse them once, with the first WAD standing in for all of them.
+	std::vector<std::string> planArguments{ wadFileNames[0] };
+	planArguments.insert(planArguments.end(), arguments.begin(), arguments.end());
+
+	// Several WADs at once can't all ask the one terminal for names.
+	CommandPlan plan{};
+	plan.setAskingForNames(false);
+	if (!plan.parseArguments(planArguments, out))
+		return false;
+
+	if (!plan.getOutputName().empty())
+	{
+		out << "WADCLI: --output can't be used on many WADs at once, they'd all be written to the same file.\n";
+		return false;
+	}
+
+	const uint32_t numWADs{ static_cast<uint32_t>(wadFileNames.size()) };
+	const unsigned int numJobs{ std::max(plan.getNumJobs(), 1u) };
+	const unsigned int wadsAtOnce{ std::min(numJobs, numWADs) };
+	const unsigned int jobsPerWAD{ numJobs / wadsAtOnce };
+
+	// --max-memory is for all of them together.
+	const uint64_t maxMemoryPerWAD{ plan.getMaxMemory() / wadsAtOnce };
+
+	std::vector<uint8_t> succeeded(numWADs, false);
+	std::vector<uint32_t> tasks(numWADs);
+	std::iota(tasks.begin(), tasks.end(), 0);
+
+	std::mutex outMutex;
+	uint32_t numFinished{ 0 };
+
+	ThreadPool wadPool{ wadsAtOnce };
+	wadPool.runTasks(tasks, [&](uint32_t i)
+	{
+		CommandPlan wadPlan{ plan };
+		wadPlan.setWADFileName(wadFileNames[i]);
+		wadPlan.setMaxMemory(maxMemoryPerWAD);
+
+		// One WAD per thread is the usual, so most of them don't need a pool of their own.
+		std::shared_ptr<ThreadPool> threadPool{};
+		if (jobsPerWAD > 1 && !wadPlan.isListingOnly() && !wadPlan.isExplaining())
+			threadPool = std::make_shared<ThreadPool>(jobsPerWAD);
+
+		std::ostringstream wadOut{};
+		succeeded[i] = wadPlan.runOnWAD(threadPool, wadOut);
+
+		std::lock_guard<std::mutex> lock{ outMutex };
+		out << "WADCLI: [" << ++numFinished << '/' << numWADs << "] " << wadFileNames[i] <<
+			(succeeded[i] ? "\n" : " failed:\n") << wadOut.str();
+	});
+
+	const size_t numFailed{ static_cast<size_t>(std::count(succeeded.begin(), succeeded.end(), false)) };
+	out << "WADCLI: " << (numWADs - numFailed) << " of " << numWADs << " WAD(s) done";
+	if (numFailed == 0)
+	{
+		out << ".\n";
+		return true;
+	}
+
+	out << ", " << numFailed << " failed:\n";
+	for (uint32_t i = 0; i < numWADs; ++i)
+	{
+		if (!succeeded[i])
+			out << "  " << wadFileNames[i] << '\n';
+	}
+
+	return false;
+}
+
+size_t WadBatch::getNumWADs() const { return wadFileNames.size(); }
+
+void WadBatch::addWAD(const std::string& fileName)
+{
+	// The same WAD twice would have two threads writing to it.
+	std::error_code error;
+	std::string key{ std::filesystem::weakly_canonical(fileName, error).string() };
+	if (error)
+		key = fileName;
+
+	if (!wadKeys.insert(std::move(key)).second)
+		return;
+
+	wadFileNames.push_back(fileName);
+}
+
+bool WadBatch::addMatchingWADs(const std::string& target, std::ostream& out)
+{
+	const std::filesystem::path targetPath{ target };
+	const std::string folder{ targetPath.parent_path().empty() ? "." : targetPath.parent_path().string() };
+	const std::string pattern{ targetPath.filename().string() };
+
+	if (folder.find_first_of("*?") != std::string::npos)
+	{
+		out << "WADCLI: Only the file name in " << target << " can have a * or ? in it.\n";
+		return false;
+	}
+
+	std::vector<std::string> matches{};
+	std::error_code error;
+	for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator{ folder, error })
+	{
+		if (entry.is_regular_file(error) &&
+			LumpPattern::matchesGlob(entry.path().filename().string(), pattern))
+		{
+			matches.push_back(targetPath.parent_path().empty() ?
+				entry.path().filename().string() : entry.path().string());
+		}
+	}
+
+	if (matches.empty())
+		out << "WADCLI: Nothing matched " << target << ".\n";
+
+	// Directories come in whatever order, but the output shouldn't.
+	std::sort(matches.begin(), matches.end());
+	for (const std::string& match : matches)
+		(*this).addWAD(match);
+
+	return true;
+}
+
+void WadBatch::addFolder(const std::string& folder)
+{
+	std::vector<std::string> wads{};
+	std::error_code error;
+	for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator{ folder, error })
+	{
+		std::string extension{ entry.path().extension().string() };
+		std::transform(extension.begin(), extension.end(), extension.begin(),
+			[](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+
+		if (extension == ".wad" && entry.is_regular_file(error))
+			wads.push_back(entry.path().string());
+	}
+
+	std::sort(wads.begin(), wads.end());
+	for (const std::string& wad : wads)
+		(*this).addWAD(wad);
+}
@@ -24,32 +24,51 @@ EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 */
 
 #include <fstream>
+#include <cstdio>
 #include <cstring>
 #include <vector>
 #include <iostream>
 #include <functional>
+#include <algorithm>
+#include <filesystem>
+#include <random>
+#include <type_traits>
 #include <liblzf/lzf.h>
+#include <climits>
+#include <cstdlib>
+#include <cerrno>
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#endif
 #include "headers/wadformat.h"
+#include "headers/lumppattern.h"
+#include "headers/namescan.h"
 
 WadFormat::WadFormat(std::string_view fileName)
-	: wadType{ WadType::INVALID }, wadName{ fileName }, wadNumFiles{ 0 }, wadOffFAT{ 12 }, wadFiles{ 0 }
+	: wadType{ WadType::INVALID }, wadName{ fileName }, wadNumFiles{ 0 }, wadOffFAT{ 12 }, lumpDataLoaded{ true }, maxMemory{ 0 }
 {
 	// empty.
 }
 
 WadFormat::WadFormat()
-	: wadType{ WadType::PWAD }, wadName{ "new.wad" }, wadNumFiles{ 0 }, wadOffFAT{ 12 }, wadFiles{ 0 }
+	: wadType{ WadType::PWAD }, wadName{ "new.wad" }, wadNumFiles{ 0 }, wadOffFAT{ 12 }, lumpDataLoaded{ true }, maxMemory{ 0 }
 {
 	// empty.
 }
 
 WadFormat::WadFormat(std::string_view name, WadType type)
-	: wadType{ type }, wadName{ name }, wadNumFiles{ 0 }, wadOffFAT{ 12 }, wadFiles{ 0 }
+	: wadType{ type }, wadName{ name }, wadNumFiles{ 0 }, wadOffFAT{ 12 }, lumpDataLoaded{ true }, maxMemory{ 0 }
 {
 	// empty.
 }
 
-bool WadFormat::exportWAD(std::string_view fileName)
+bool WadFormat::exportWAD(std::string_view fileName, ExportMode mode)
 {
 	if (WadFormat::getWADType() == WadType::INVALID)
 	{
@@ -57,136 +76,993 @@ bool WadFormat::exportWAD(std::string_view fileName)
 		return false;
 	}
 
-	std::ofstream newWadStream{ fileName.data() };
+	if (!lumpDataLoaded)
+	{
+		std::cerr << "exportWAD: Only the file list of this WAD was read. Quitting early." << '\n';
+		return false;
+	}
 
-	// Type of wad, number of files, location of FAT.
-	newWadStream.write(WadFormat::getWADTypeToChar().data(), sizeof(char) * 4);
+	const bool toStandardOutput{ fileName == "-" };
+	if (!toStandardOutput && mode == ExportMode::IN_PLACE && (*this).updateWADInPlace(fileName))
+		return true;
 
-	uint32_t numFiles{ WadFormat::getNumFiles() }; 
-	newWadStream.write(reinterpret_cast<const char*>(&numFiles), sizeof(numFiles));
+#ifdef _WIN32
+	// Windows won't replace a file that's still mapped, so anything
+	// pointing into it has to be copied out first.
+	if (!toStandardOutput)
+		(*this).unmapLumpsFromFile(fileName);
+#endif
 
-	const long long int FATOffsetPos{ newWadStream.tellp() };
-	newWadStream.write("0000", sizeof(char) * 4);
+	const uint32_t numFiles{ WadFormat::getNumFiles() };
 
-	// TIME TO DUMP ALL THE DATA!
+	// All the sizes are known up front, so the offsets are too.
 	std::vector<uint32_t> dataOffsets{};
 	dataOffsets.resize(numFiles);
 
+	uint64_t position{ 12 };
 	for (size_t i = 0; i < numFiles; ++i)
 	{
-		dataOffsets[i] = newWadStream.tellp();
-		newWadStream.write(&(*this)[i].binaryData[0], (*this)[i].dataSize);
+		dataOffsets[i] = static_cast<uint32_t>(position);
+		position += lumpSizes[i];
 	}
-	
-	// We dumped everything, now let's set the FAT offset.
-	const uint32_t FATOffsetStart{ static_cast<uint32_t>(newWadStream.tellp()) };
-	newWadStream.seekp(FATOffsetPos);
-	newWadStream.write(reinterpret_cast<const char*>(&FATOffsetStart), sizeof(FATOffsetStart));
-	newWadStream.seekp(FATOffsetStart);
 
-	// Time to write the FAT.
-	for (size_t i = 0; i < numFiles; ++i)
+	if (position > UINT32_MAX)
 	{
-		// std::cout << "inside " << i << "\n";
-		newWadStream.write(reinterpret_cast<const char*>(&dataOffsets[i]), sizeof(dataOffsets[i]));
-		newWadStream.write(reinterpret_cast<const char*>(&(*this)[i].dataSize), sizeof((*this)[i].dataSize));
+		std::cerr << "exportWAD: " << fileName << " would be too big for a WAD. Quitting early." << '\n';
+		return false;
+	}
 
-		size_t stringLength{ (*this)[i].name.size() };
-		newWadStream.write((*this)[i].name.c_str(),
-			static_cast<long long int>(stringLength > fileNameLength ? fileNameLength : stringLength) );
+	const uint32_t FATOffsetStart{ static_cast<uint32_t>(position) };
+	size_t copiedBytes{ 0 };
 
-		// Write empty data if string is less than 8.
-		if (stringLength < fileNameLength)
+	// Nothing gets seeked back to, so it can go straight down a pipe.
+	if (toStandardOutput)
+	{
+#ifdef _WIN32
+		_setmode(_fileno(stdout), _O_BINARY);
+#endif
+		if (!(*this).writeWAD(stdout, dataOffsets, FATOffsetStart, copiedBytes) || std::fflush(stdout) != 0)
 		{
-			// This looks so silly...
-			stringLength = fileNameLength - stringLength;
-			newWadStream.write("\0\0\0\0\0\0\0\0", static_cast<long long int>(stringLength));
+			std::cerr << "exportWAD: Could not write the WAD to the standard output." << '\n';
+			return false;
 		}
 
-		if constexpr (DEBUG) 
-			std::cout << (*this)[i].name.c_str() << '\n';
+		return true;
+	}
+
+	// If we're writing over the WAD we came from, the lumps get pointed
+	// at the new one once it's in place.
+	std::error_code error;
+	const bool replacesSource{ sourceFile != nullptr &&
+		std::filesystem::equivalent((*sourceFile).getFileName(), fileName, error) };
+
+	// Everything goes into a temporary file next to the target first. It only
+	// replaces the target once it's all on disk, so a crash halfway through
+	// leaves the old WAD alone.
+	std::string tempName{};
+	FILE* newWadFile{ WadFormat::createTempFile(fileName, tempName) };
+	if (newWadFile == nullptr)
+	{
+		std::cerr << "exportWAD: Could not open " << fileName << " for writing." << '\n';
+		return false;
+	}
+
+	std::setvbuf(newWadFile, nullptr, _IOFBF, readBufferSize);
+
+	const bool writeFailed{ !(*this).writeWAD(newWadFile, dataOffsets, FATOffsetStart, copiedBytes) };
+	if (writeFailed || !WadFormat::finishTempFile(newWadFile, tempName, fileName))
+	{
+		std::cerr << "exportWAD: Could not write " << fileName << " properly." << '\n';
+		return false;
+	}
+
+	if constexpr (DEBUG)
+	{
+		for (size_t i = 0; i < numFiles; ++i)
+			std::cout << WadFormat::unpackLumpName(lumpNames[i]) << '\n';
 	}
 	
 	if constexpr (DEBUG) 
-		std::cout << "Done exporting " << fileName << ".\n";
+		std::cout << "Done exporting " << fileName << ", " << copiedBytes << " bytes copied by the kernel.\n";
+
+	if (replacesSource)
+	{
+		lumpOffsets = std::move(dataOffsets);
+		wadOffFAT = FATOffsetStart;
+		(*this).mapLumpsToFile(fileName);
+	}
+
+	return true;
+}
+
+bool WadFormat::writeWAD(FILE* file, const std::vector<uint32_t>& dataOffsets, uint32_t FATOffset,
+	size_t& copiedBytes)
+{
+	char header[12]{};
+	(*this).writeHeader(header, FATOffset);
+
+	// TIME TO DUMP ALL THE DATA!
+	// Lumps in memory are gathered up and written in big batches. Lumps that are
+	// still untouched slices of a mapped file get copied over by the kernel,
+	// back to back runs of them in one go.
+	std::vector<std::string_view> batch{ std::string_view{ header, sizeof(header) } };
+	bool writeFailed{ false };
+
+	for (size_t i = 0; i < wadNumFiles && !writeFailed;)
+	{
+		LumpData& lump{ lumpData[i] };
+		size_t runEnd{ i + 1 };
+		size_t runSize{ lumpSizes[i] };
+
+		if (lump.mappedFile != nullptr && !(*lump.mappedFile).isInMemory())
+		{
+			while (runEnd < wadNumFiles && lumpData[runEnd].mappedFile == lump.mappedFile &&
+				lumpData[runEnd].mappedData == lump.mappedData + runSize)
+			{
+				runSize += lumpSizes[runEnd];
+				++runEnd;
+			}
+
+			writeFailed = !WadFormat::writeBuffers(file, batch);
+			batch.clear();
+
+			const char* fileStart{ (*lump.mappedFile).getData() };
+			const size_t copied{ (*lump.mappedFile).copyRangeTo(file,
+				static_cast<size_t>(lump.mappedData - fileStart), runSize) };
+
+			copiedBytes += copied;
+			batch.emplace_back(lump.mappedData + copied, runSize - copied);
+		}
+		else
+			batch.emplace_back(lump.getData(), runSize);
+
+		i = runEnd;
+	}
+
+	// Time to write the FAT.
+	std::vector<char> directory{ (*this).buildDirectory(dataOffsets) };
+	batch.emplace_back(directory.data(), directory.size());
+
+	return !writeFailed && WadFormat::writeBuffers(file, batch);
+}
+
+bool WadFormat::updateWADInPlace(std::string_view fileName)
+{
+	// Only works on the very file we were read from, as it was back then.
+	if (sourceFile == nullptr)
+		return false;
+
+	std::error_code error;
+	if (!std::filesystem::equivalent((*sourceFile).getFileName(), fileName, error) || error ||
+		std::filesystem::file_size(fileName, error) != (*sourceFile).getSize() || error)
+		return false;
+
+	const char* sourceData{ (*sourceFile).getData() };
+	const uint64_t sourceSize{ (*sourceFile).getSize() };
+
+	// Anything that isn't still sitting in the file gets appended to it.
+	uint64_t reusedBytes{ 0 };
+	uint64_t appendedBytes{ static_cast<uint64_t>(wadNumFiles) * 16 };
+	for (uint32_t i = 0; i < wadNumFiles; ++i)
+	{
+		if (lumpData[i].mappedFile == sourceFile)
+			reusedBytes += lumpSizes[i];
+		else
+			appendedBytes += lumpSizes[i];
+	}
+
+	// Appending more than what we keep just makes the file balloon,
+	// we might as well write it from scratch at that point.
+	if (appendedBytes > reusedBytes || sourceSize + appendedBytes > UINT32_MAX)
+		return false;
+
+	// Even when only the file list changed (renames, moves, deletes), the new one
+	// goes after everything else. Writing over the old one would leave a WAD that's
+	// half of each if we got interrupted, this way the old one is there until the end.
+	FILE* wadFile{ std::fopen(std::string{ fileName }.c_str(), "r+b") };
+	if (wadFile == nullptr)
+		return false;
+
+	std::vector<uint32_t> dataOffsets{};
+	dataOffsets.resize(wadNumFiles);
+
+	uint64_t position{ sourceSize };
+#ifdef _WIN32
+	bool written{ _fseeki64(wadFile, static_cast<__int64>(position), SEEK_SET) == 0 };
+#else
+	bool written{ fseeko(wadFile, static_cast<off_t>(position), SEEK_SET) == 0 };
+#endif
+
+	for (uint32_t i = 0; i < wadNumFiles && written; ++i)
+	{
+		if (lumpData[i].mappedFile == sourceFile)
+		{
+			// Untouched, so it stays where it is.
+			dataOffsets[i] = static_cast<uint32_t>(lumpData[i].mappedData - sourceData);
+			continue;
+		}
+
+		dataOffsets[i] = static_cast<uint32_t>(position);
+		written = std::fwrite(lumpData[i].getData(), sizeof(char), lumpSizes[i], wadFile) == lumpSizes[i];
+		position += lumpSizes[i];
+	}
+
+	const uint32_t FATOffset{ static_cast<uint32_t>(position) };
+	std::vector<char> directory{ (*this).buildDirectory(dataOffsets) };
+	written = written && std::fwrite(directory.data(), sizeof(char), directory.size(), wadFile) == directory.size();
+
+	// Everything the new header points at has to be on disk before the header is,
+	// or a crash could leave the header pointing at whatever was there before.
+	if (!written || !WadFormat::syncFile(wadFile))
+	{
+		std::fclose(wadFile);
+		return false;
+	}
+
+	// Last of all, point the header at the new file list.
+	// Up until now, the file still reads as the WAD it was before.
+	char header[12]{};
+	(*this).writeHeader(header, FATOffset);
+
+	written = std::fseek(wadFile, 0, SEEK_SET) == 0 &&
+		std::fwrite(header, sizeof(char), sizeof(header), wadFile) == sizeof(header) &&
+		WadFormat::syncFile(wadFile);
+	written = std::fclose(wadFile) == 0 && written;
+
+	if (!written)
+	{
+		std::cerr << "exportWAD: Could not update the header of " << fileName << ".\n";
+		return false;
+	}
+
+	lumpOffsets = std::move(dataOffsets);
+	wadOffFAT = FATOffset;
+
+	if constexpr (DEBUG)
+		std::cout << "Updated " << fileName << " in place, appended " <<
+			(position + directory.size() - sourceSize) << " bytes.\n";
+
+	(*this).mapLumpsToFile(fileName);
+	return true;
+}
+
+void WadFormat::mapLumpsToFile(std::string_view fileName)
+{
+	// Everything is in the file now, so point the lumps back into it
+	// instead of holding on to their bytes.
+	std::shared_ptr<MappedFile> mapping{ std::make_shared<MappedFile>() };
+	if ((*mapping).openFile(fileName))
+	{
+		for (uint32_t i = 0; i < wadNumFiles; ++i)
+			lumpData[i] = { mapping, (*mapping).getData() + lumpOffsets[i] };
+
+		sourceFile = std::move(mapping);
+	}
+	else
+		sourceFile.reset();
+}
+
+FILE* WadFormat::createTempFile(std::string_view fileName, std::string& tempName)
+{
+	// Write through symlinks instead of replacing them.
+	std::error_code error;
+	std::filesystem::path target{ fileName };
+	if (std::filesystem::is_symlink(target, error))
+	{
+		target = std::filesystem::canonical(target, error);
+		if (error)
+			return nullptr;
+	}
+
+#ifdef _WIN32
+	tempName = target.string() + ".tmp";
+	return std::fopen(tempName.c_str(), "wb");
+#else
+	tempName = target.string() + ".XXXXXX";
+	const int fileDescriptor{ mkstemp(tempName.data()) };
+	if (fileDescriptor == -1)
+		return nullptr;
+
+	// mkstemp only lets us read it, give it what a new file would have
+	// or whatever the file we're replacing had.
+	struct stat targetStatus{};
+	if (stat(target.c_str(), &targetStatus) == 0)
+		fchmod(fileDescriptor, targetStatus.st_mode & 07777);
+	else
+	{
+		const mode_t mask{ umask(0) };
+		umask(mask);
+		fchmod(fileDescriptor, 0666 & ~mask);
+	}
+
+	FILE* file{ fdopen(fileDescriptor, "wb") };
+	if (file == nullptr)
+	{
+		close(fileDescriptor);
+		std::remove(tempName.c_str());
+	}
+
+	return file;
+#endif
+}
+
+bool WadFormat::writeBuffers(FILE* file, const std::vector<std::string_view>& buffers)
+{
+#ifdef _WIN32
+	for (const std::string_view& buffer : buffers)
+	{
+		if (std::fwrite(buffer.data(), sizeof(char), buffer.size(), file) != buffer.size())
+			return false;
+	}
+
+	return true;
+#else
+	if (std::fflush(file) != 0)
+		return false;
+
+	const int fileDescriptor{ fileno(file) };
+	std::vector<iovec> vectors{};
+
+	for (size_t next = 0; next < buffers.size();)
+	{
+		vectors.clear();
+		for (; next < buffers.size() && vectors.size() < IOV_MAX; ++next)
+		{
+			if (!buffers[next].empty())
+				vectors.push_back({ const_cast<char*>(buffers[next].data()), buffers[next].size() });
+		}
+
+		// writev can stop short, so pick up from wherever it left off.
+		iovec* current{ vectors.data() };
+		size_t remaining{ vectors.size() };
+		while (remaining > 0)
+		{
+			ssize_t written{ writev(fileDescriptor, current, static_cast<int>(remaining)) };
+			if (written == -1)
+			{
+				if (errno == EINTR)
+					continue;
+
+				return false;
+			}
+
+			while (remaining > 0 && static_cast<size_t>(written) >= (*current).iov_len)
+			{
+				written -= static_cast<ssize_t>((*current).iov_len);
+				++current;
+				--remaining;
+			}
+
+			if (remaining > 0)
+			{
+				(*current).iov_base = static_cast<char*>((*current).iov_base) + written;
+				(*current).iov_len -= static_cast<size_t>(written);
+			}
+		}
+	}
+
+	// writev moved the file offset behind stdio's back, so catch it up.
+	// Pipes don't have one, which is fine too.
+	const off_t endPosition{ lseek(fileDescriptor, 0, SEEK_CUR) };
+	if (endPosition == -1)
+		return errno == ESPIPE;
+
+	return fseeko(file, endPosition, SEEK_SET) == 0;
+#endif
+}
+
+bool WadFormat::finishTempFile(FILE* file, std::string_view tempName, std::string_view fileName)
+{
+	// Make sure it's all really on disk before it takes the target's place.
+	bool finished{ WadFormat::syncFile(file) };
+	finished = std::fclose(file) == 0 && finished;
+
+	std::error_code error;
+	std::filesystem::path target{ fileName };
+	if (std::filesystem::is_symlink(target, error))
+		target = std::filesystem::canonical(target, error);
+	else
+		error.clear();
+
+	if (finished && !error)
+		std::filesystem::rename(tempName, target, error);
+
+	if (!finished || error)
+	{
+		std::filesystem::remove(tempName, error);
+		return false;
+	}
+
+#ifndef _WIN32
+	// The rename itself lives in the directory, so that needs syncing too.
+	std::filesystem::path directory{ target.parent_path() };
+	const int directoryDescriptor{ open(directory.empty() ? "." : directory.c_str(), O_RDONLY) };
+	if (directoryDescriptor != -1)
+	{
+		fsync(directoryDescriptor);
+		close(directoryDescriptor);
+	}
+#endif
+
+	return true;
+}
+
+bool WadFormat::syncFile(FILE* file)
+{
+	// Past stdio's buffers and the OS's, all the way to the disk.
+	if (std::fflush(file) != 0 || std::ferror(file) != 0)
+		return false;
+
+#ifdef _WIN32
+	return _commit(_fileno(file)) == 0;
+#else
+	return fsync(fileno(file)) == 0;
+#endif
+}
+
+void WadFormat::writeHeader(char* header, uint32_t FATOffset)
+{
+	// Type of wad, number of files, location of FAT.
+	std::memcpy(header, WadFormat::getWADTypeToChar().data(), 4);
+	std::memcpy(header + 4, &wadNumFiles, sizeof(uint32_t));
+	std::memcpy(header + 8, &FATOffset, sizeof(uint32_t));
+}
+
+std::vector<char> WadFormat::buildDirectory(const std::vector<uint32_t>& dataOffsets)
+{
+	std::vector<char> directory{};
+	directory.resize(static_cast<size_t>(wadNumFiles) * 16);
+
+	char* entry{ directory.data() };
+	for (size_t i = 0; i < wadNumFiles; ++i, entry += 16)
+	{
+		std::memcpy(entry, &dataOffsets[i], sizeof(uint32_t));
+		std::memcpy(entry + 4, &lumpSizes[i], sizeof(uint32_t));
+
+		// Packed names are already null-padded to 8 characters.
+		std::memcpy(entry + 8, &lumpNames[i], fileNameLength);
+	}
+
+	return directory;
+}
+
+bool WadFormat::importWAD(std::string_view fileName, ImportMode mode)
+{
+	// Pipes and the standard input can't be mapped or seeked around in.
+	std::error_code error;
+	if (fileName == "-" || (std::filesystem::exists(fileName, error) &&
+		!std::filesystem::is_regular_file(fileName, error)))
+		return (*this).importStreamedWAD(fileName, mode);
+
+	// Mapping can fail on files mmap doesn't like (empty ones, for example),
+	// in which case we just read everything like we used to.
+	if (mode == ImportMode::MAPPED)
+	{
+		std::shared_ptr<MappedFile> mapping{ std::make_shared<MappedFile>() };
+		if ((*mapping).openFile(fileName))
+			return (*this).importMappedWAD(mapping);
+	}
+	else if (mode == ImportMode::ARENA)
+	{
+		// Same as mapping it, only the lumps and names all live in one
+		// allocation of our own instead of the page cache.
+		std::shared_ptr<MappedFile> wholeFile{ std::make_shared<MappedFile>() };
+		if (!(*wholeFile).readFile(fileName) || !(*this).importMappedWAD(wholeFile))
+			return false;
+
+		lumpArena = std::make_shared<LumpArena>();
+
+		if constexpr (DEBUG)
+			std::cout << "Read " << wadNumFiles << " lumps from " << fileName << " with 1 allocation of " <<
+				(*wholeFile).getSize() << " bytes.\n";
+
+		return true;
+	}
+	else if (mode == ImportMode::DIRECTORY_ONLY)
+		return (*this).importDirectoryOnly(fileName);
+
+	return (*this).importBufferedWAD(fileName);
+}
+
+// Like fseek, but for offsets past 2 GB on Windows too.
+static bool seekFileTo(std::FILE* file, uint64_t offset)
+{
+#ifdef _WIN32
+	return _fseeki64(file, static_cast<long long int>(offset), SEEK_SET) == 0;
+#else
+	return fseeko(file, static_cast<off_t>(offset), SEEK_SET) == 0;
+#endif
+}
+
+bool WadFormat::importBufferedWAD(std::string_view fileName)
+{
+	std::error_code error;
+	const uint64_t wadSize{ std::filesystem::file_size(fileName, error) };
+	if (error || wadSize < 12)
+		return false;
+
+	std::FILE* wadBinary{ std::fopen(fileName.data(), "rb") };
+	if (wadBinary == nullptr)
+		return false;
+
+	// Small lumps get served from this instead of one read each.
+	std::vector<char> readBuffer{};
+	readBuffer.resize(readBufferSize);
+	std::setvbuf(wadBinary, readBuffer.data(), _IOFBF, readBuffer.size());
+
+#ifndef _WIN32
+	// We're going to go through the file front to back, let the kernel know.
+	posix_fadvise(fileno(wadBinary), 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+
+	char header[12]{};
+	std::vector<char> directory{};
+	bool success{ std::fread(header, 1, sizeof(header), wadBinary) == sizeof(header) };
+
+	if (success)
+	{
+		(*this).readHeader(header);
+
+		if (wadOffFAT + static_cast<uint64_t>(wadNumFiles) * 16 > wadSize)
+		{
+			std::cerr << "importWAD: " << fileName << "'s file list goes past the end of the file.\n";
+			success = false;
+		}
+	}
+
+	// The whole file list in a single read.
+	if (success)
+	{
+		directory.resize(static_cast<size_t>(wadNumFiles) * 16);
+		success = seekFileTo(wadBinary, wadOffFAT) &&
+			std::fread(directory.data(), 1, directory.size(), wadBinary) == directory.size();
+	}
+
+	if (success)
+	{
+		(*this).readDirectory(directory.data());
+
+		// Read lumps in the order they're in the file rather than the order
+		// they're listed in, so we only ever move forward through it.
+		std::vector<uint32_t> readOrder{};
+		readOrder.resize(wadNumFiles);
+		for (uint32_t i = 0; i < wadNumFiles; ++i)
+			readOrder[i] = i;
+
+		std::stable_sort(readOrder.begin(), readOrder.end(), [this](uint32_t a, uint32_t b)
+			{ return lumpOffsets[a] < lumpOffsets[b]; });
+
+		// Where the FILE* cursor is at.
+		uint64_t filePosition{ wadOffFAT + static_cast<uint64_t>(directory.size()) };
+
+		for (uint32_t index : readOrder)
+		{
+			const uint32_t dataOffset{ lumpOffsets[index] };
+			const uint32_t dataSize{ lumpSizes[index] };
+
+			if (dataOffset + static_cast<uint64_t>(dataSize) > wadSize)
+			{
+				std::cerr << "importWAD: Lump #" << index << " in " << fileName <<
+					" goes past the end of the file.\n";
+				success = false;
+				break;
+			}
+
+			if (dataSize == 0)
+				continue;
+
+			// Only overlapping lumps ever make us go back.
+			if (dataOffset != filePosition && !seekFileTo(wadBinary, dataOffset))
+			{
+				success = false;
+				break;
+			}
+
+			char* binary{ lumpData[index].getMutableData(dataSize) };
+			if (binary == nullptr || std::fread(binary, 1, dataSize, wadBinary) != dataSize)
+			{
+				success = false;
+				break;
+			}
+
+			filePosition = dataOffset + static_cast<uint64_t>(dataSize);
+		}
+	}
+
+	std::fclose(wadBinary);
 
-	newWadStream.close();
+	if (!success)
+	{
+		(*this).clearLumps();
+		return false;
+	}
+
+	lumpDataLoaded = true;
 	return true;
 }
 
-bool WadFormat::importWAD(std::string_view fileName)
+bool WadFormat::importMappedWAD(std::shared_ptr<MappedFile>& mapping)
 {
-	std::ifstream wadBinary{ fileName.data(), std::ios_base::binary };
+	std::string_view fileName{ (*mapping).getFileName() };
+	const char* wadData{ (*mapping).getData() };
+	const uint64_t wadSize{ (*mapping).getSize() };
+
+	if (wadSize < 12)
+		return false;
+
+	(*this).readHeader(wadData);
+
+	// Reading out of the mapping means crashing instead of reading garbage,
+	// so anything pointing outside of the file is a no-go.
+	if (wadOffFAT + static_cast<uint64_t>(wadNumFiles) * 16 > wadSize)
+	{
+		std::cerr << "importWAD: " << fileName << "'s file list goes past the end of the file.\n";
+		return false;
+	}
+
+	(*this).readDirectory(wadData + wadOffFAT);
+
+	for (size_t i = 0; i < wadNumFiles; ++i)
+	{
+		if (lumpOffsets[i] + static_cast<uint64_t>(lumpSizes[i]) > wadSize)
+		{
+			std::cerr << "importWAD: Lump #" << i << " in " << fileName <<
+				" goes past the end of the file.\n";
+			(*this).clearLumps();
+			return false;
+		}
+
+		lumpData[i].mappedFile = mapping;
+		lumpData[i].mappedData = wadData + lumpOffsets[i];
+	}
+
+	sourceFile = mapping;
+	lumpDataLoaded = true;
+
+	if constexpr (DEBUG)
+		std::cout << "Mapped " << wadSize << " bytes from " << fileName << ".\n";
+
+	return true;
+}
+
+bool WadFormat::importDirectoryOnly(std::string_view fileName)
+{
+	std::ifstream wadBinary{ fileName.data(), std::ios_base::binary | std::ios_base::ate };
 
 	if (!wadBinary || wadBinary.fail())
 		return false;
 
+	const uint64_t wadSize{ static_cast<uint64_t>(wadBinary.tellg()) };
+	wadBinary.seekg(0);
+
+	char header[12]{};
+	if (!wadBinary.read(header, sizeof(header)))
+		return false;
+
+	(*this).readHeader(header);
+
+	if (wadOffFAT + static_cast<uint64_t>(wadNumFiles) * 16 > wadSize)
+	{
+		std::cerr << "importWAD: " << fileName << "'s file list goes past the end of the file.\n";
+		return false;
+	}
+
+	// The whole file list in one go, and none of the lumps.
+	std::vector<char> directory{};
+	directory.resize(static_cast<size_t>(wadNumFiles) * 16);
+
+	wadBinary.seekg(wadOffFAT);
+	if (!wadBinary.read(directory.data(), directory.size()))
+		return false;
+
+	(*this).readDirectory(directory.data());
+	lumpDataLoaded = false;
+
+	if constexpr (DEBUG)
+		std::cout << "Read " << directory.size() << " bytes of file list from " << fileName << ".\n";
+
+	return true;
+}
+
+bool WadFormat::importStreamedWAD(std::string_view fileName, ImportMode mode)
+{
+	const bool fromStandardInput{ fileName == "-" };
+	std::FILE* input{ fromStandardInput ? stdin : std::fopen(fileName.data(), "rb") };
+	if (input == nullptr)
+		return false;
+
+#ifdef _WIN32
+	if (fromStandardInput)
+		_setmode(_fileno(stdin), _O_BINARY);
+#endif
+
+	bool imported{ false };
+	if (mode == ImportMode::DIRECTORY_ONLY)
+		imported = (*this).readStreamedDirectory(input);
+	else
+	{
+		// The file list is usually at the very end, and the lumps before it are
+		// needed anyway, so the whole thing gets kept in a temporary file.
+		std::shared_ptr<MappedFile> mapping{ std::make_shared<MappedFile>() };
+		imported = (*mapping).openStream(input) && (*this).importMappedWAD(mapping);
+	}
+
+	if (!fromStandardInput)
+		std::fclose(input);
+
+	if (!imported)
+		std::cerr << "importWAD: Could not read a WAD from " << (fromStandardInput ? "the standard input" : fileName) << ".\n";
+
+	return imported;
+}
+
+bool WadFormat::readStreamedDirectory(FILE* input)
+{
+	char header[12]{};
+	if (std::fread(header, sizeof(char), sizeof(header), input) != sizeof(header))
+		return false;
+
+	(*this).readHeader(header);
+	if (wadOffFAT < sizeof(header))
+		return false;
+
+	// Only the file list is needed, so whatever comes before it gets thrown away.
+	std::vector<char> buffer{};
+	buffer.resize(readBufferSize);
+
+	uint64_t skipped{ sizeof(header) };
+	while (skipped < wadOffFAT)
+	{
+		const size_t toSkip{ static_cast<size_t>(std::min<uint64_t>(buffer.size(), wadOffFAT - skipped)) };
+		if (std::fread(buffer.data(), sizeof(char), toSkip, input) != toSkip)
+			return false;
+
+		skipped += toSkip;
+	}
+
+	std::vector<char> directory{};
+	directory.resize(static_cast<size_t>(wadNumFiles) * 16);
+	if (std::fread(directory.data(), sizeof(char), directory.size(), input) != directory.size())
+	{
+		std::cerr << "importWAD: The file list goes past the end of the file.\n";
+		return false;
+	}
+
+	(*this).readDirectory(directory.data());
+	lumpDataLoaded = false;
+	return true;
+}
+
+void WadFormat::readHeader(const char* header)
+{
 	// Get type of wad: IWAD or PWAD.
-	char wadTypeChar = wadBinary.get();
+	char wadTypeChar = header[0];
 	wadType = 	 wadTypeChar == 'I' ? 	WadType::IWAD :
 				(wadTypeChar == 'P' ? 	WadType::PWAD :
 				(wadTypeChar == 'Z' ? 	WadType::ZWAD :
 										WadType::INVALID));
 
-	// Skip three - these are supposed to be the "WAD" 
-	// chars which we don't care about.
-	wadBinary.seekg(4);
-	
-	// Get number of files and the offset to the FAT
-	const int length{ 4 };
-	char* buffer = new char[length];
+	// Number of files and the offset to the FAT come after the "WAD" chars.
+	std::memcpy(&wadNumFiles, header + 4, sizeof(uint32_t));
+	std::memcpy(&wadOffFAT, header + 8, sizeof(uint32_t));
+}
 
-	wadBinary.read(buffer, length);
-	std::memcpy(&wadNumFiles, buffer, sizeof(uint32_t));
+void WadFormat::readDirectory(const char* directory)
+{
+	const uint32_t numFiles{ wadNumFiles };
+	(*this).clearLumps();
 
-	wadBinary.read(buffer, length);
-	std::memcpy(&wadOffFAT, buffer, sizeof(uint32_t));
+	lumpNames.resize(numFiles);
+	lumpOffsets.resize(numFiles);
+	lumpSizes.resize(numFiles);
+	lumpData.resize(numFiles);
 
-	// Ok, let's get to the file list.
-	wadBinary.seekg(wadOffFAT);
-	wadFiles.reserve(wadNumFiles * sizeof(WadFile));
+	const char* entry{ directory };
+	for (size_t i = 0; i < numFiles; ++i, entry += 16)
+	{
+		std::memcpy(&lumpOffsets[i], entry, sizeof(uint32_t));
+		std::memcpy(&lumpSizes[i], entry + 4, sizeof(uint32_t));
 
-	for (size_t i = 0; i < wadNumFiles; ++i)
+		// Names aren't null-terminated when they're 8 characters long.
+		lumpNames[i] = WadFormat::packLumpName(std::string_view{ entry + 8, fileNameLength });
+	}
+
+	wadNumFiles = numFiles;
+	(*this).rebuildNameIndex();
+}
+
+void WadFormat::appendLump(uint64_t name, uint32_t offset, uint32_t size, LumpData&& data)
+{
+	lumpNames.push_back(name);
+	lumpOffsets.push_back(offset);
+	lumpSizes.push_back(size);
+	lumpData.push_back(std::move(data));
+
+	wadNumFiles++;
+	(*this).indexLump(wadNumFiles - 1);
+}
+
+void WadFormat::clearLumps()
+{
+	lumpNames.clear();
+	lumpOffsets.clear();
+	lumpSizes.clear();
+	lumpData.clear();
+	lumpNameIndex.clear();
+	wadNumFiles = 0;
+}
+
+void WadFormat::runOnEveryLump(const std::function<void(uint32_t)>& task)
+{
+	std::vector<uint32_t> indices{};
+	indices.resize(wadNumFiles);
+	for (uint32_t i = 0; i < wadNumFiles; ++i)
+		indices[i] = i;
+
+	(*this).runOnLumps(indices, task);
+}
+
+void WadFormat::runOnLumps(std::vector<uint32_t>& indices, const std::function<void(uint32_t)>& task)
+{
+	if (threadPool == nullptr || (*threadPool).getNumThreads() == 1)
 	{
-		uint32_t fileDataOffset{ 0 };
-		uint32_t fileDataSize{ 0 };
+		for (uint32_t index : indices)
+			task(index);
+
+		return;
+	}
+
+	// Biggest lumps first, or whoever gets the big one at the
+	// end of the queue keeps everyone else waiting on it.
+	std::stable_sort(indices.begin(), indices.end(), [this](uint32_t a, uint32_t b)
+		{ return lumpSizes[a] > lumpSizes[b]; });
 
-		// Where's the data at?
-		wadBinary.read(buffer, length);
-		std::memcpy(&fileDataOffset, buffer, sizeof(uint32_t));
+	(*threadPool).runTasks(indices, task);
+}
 
-		// How big's the data?
-		wadBinary.read(buffer, length);
-		std::memcpy(&fileDataSize, buffer, sizeof(uint32_t));
+void WadFormat::runOnEveryLumpWithin(const std::function<void(uint32_t)>& task,
+	const std::function<uint64_t(uint32_t)>& outputSize)
+{
+	if (maxMemory == 0)
+	{
+		(*this).runOnEveryLump(task);
+		return;
+	}
 
-		// Name of the file.
-		const int nameLength{ fileNameLength };
-		char* nameBuffer = new char[nameLength + 1]; // 8 + null terminator
-		nameBuffer[nameLength] = '\0';
-		wadBinary.read(nameBuffer, nameLength);
+	// Lumps get done a window at a time, and each window's results are moved
+	// out to a scratch file before the next one starts. A lump bigger than
+	// the whole budget still gets a window of its own.
+	std::vector<uint32_t> window{};
+	uint64_t windowSize{ 0 };
+	unsigned int windows{ 0 };
+
+	for (uint32_t i = 0; i <= wadNumFiles; ++i)
+	{
+		const uint64_t lumpOutput{ i < wadNumFiles ? outputSize(i) : 0 };
+		if (!window.empty() && (i == wadNumFiles || windowSize + lumpOutput > maxMemory))
+		{
+			// What the window reads from, so it can be let go of afterwards.
+			std::vector<LumpData> inputs{};
+			std::vector<uint32_t> inputSizes{};
+			for (uint32_t index : window)
+			{
+				inputs.push_back({ lumpData[index].mappedFile, lumpData[index].mappedData });
+				inputSizes.push_back(lumpSizes[index]);
+			}
 
-		const long long int currentPositionInFile{ wadBinary.tellg() };
+			(*this).runOnLumps(window, task);
+			(*this).spillLumps(window);
 
-		// Binary data of the file.
-		std::vector<char> binary{};
-		binary.resize(fileDataSize);
-		wadBinary.seekg(fileDataOffset);
-		wadBinary.read(&binary[0], fileDataSize);
+			for (size_t input = 0; input < inputs.size(); ++input)
+			{
+				if (inputs[input].mappedFile != nullptr)
+					(*inputs[input].mappedFile).releaseRange(inputs[input].mappedData, inputSizes[input]);
+			}
 
-		// We're done, let's put the cursor where it was before.
-		wadBinary.seekg(currentPositionInFile);
-		
-		//std::cout << nameBuffer << '\n';
-		wadFiles.push_back({fileDataOffset, fileDataSize, std::string{nameBuffer, nameLength}, std::move(binary)});
+			window.clear();
+			windowSize = 0;
+			++windows;
+		}
 
-		delete[] nameBuffer;
+		if (i < wadNumFiles)
+		{
+			window.push_back(i);
+			windowSize += lumpOutput;
+		}
 	}
 
-	// Ok, we're done.
-	delete[] buffer;
-	wadBinary.close();
+	if constexpr (DEBUG)
+		std::cout << "Went through " << wadNumFiles << " lumps in " << windows << " windows.\n";
+}
 
-	return true;
+void WadFormat::spillLumps(std::vector<uint32_t>& indices)
+{
+	// In order, so neighbouring lumps stay neighbours in the scratch file.
+	std::sort(indices.begin(), indices.end());
+
+	std::vector<std::string_view> buffers{};
+	std::vector<uint32_t> spilled{};
+	for (uint32_t index : indices)
+	{
+		const LumpData& data{ lumpData[index] };
+		if (data.mappedFile != nullptr && (*data.mappedFile).isInMemory() && lumpSizes[index] > 0)
+		{
+			buffers.emplace_back(data.mappedData, lumpSizes[index]);
+			spilled.push_back(index);
+		}
+	}
+
+	if (buffers.empty())
+		return;
+
+	// If this doesn't work out, they just stay in memory.
+	std::shared_ptr<MappedFile> spill{ std::make_shared<MappedFile>() };
+	if (!(*spill).openBuffers(buffers))
+		return;
+
+	const char* position{ (*spill).getData() };
+	for (uint32_t index : spilled)
+	{
+		lumpData[index] = { spill, position };
+		position += lumpSizes[index];
+	}
+}
+
+void WadFormat::setLumpData(const unsigned int index, std::vector<char>&& newData)
+{
+	// Only what's within the lump's size is kept, buffers tend to be a bit bigger.
+	if (lumpArena != nullptr && lumpSizes[index] > 0)
+	{
+		std::shared_ptr<MappedFile> block{};
+		const char* stored{ (*lumpArena).store(newData.data(), lumpSizes[index], block) };
+		if (stored != nullptr)
+		{
+			lumpData[index] = { std::move(block), stored };
+			return;
+		}
+	}
+
+	lumpData[index].setData(std::move(newData));
+}
+
+uint32_t WadFormat::getEndOfData()
+{
+	uint32_t sizeOffset{ 0 };
+	for (uint32_t size : lumpSizes)
+		sizeOffset += size;
+
+	return sizeOffset;
+}
+
+void WadFormat::unmapLumpsFromFile(std::string_view fileName)
+{
+	std::filesystem::path target{ fileName };
+	if (!std::filesystem::exists(target))
+		return;
+
+	std::error_code error;
+	if (sourceFile != nullptr && std::filesystem::equivalent((*sourceFile).getFileName(), target, error))
+		sourceFile.reset();
+
+	MappedFile* lastChecked{ nullptr };
+	bool isSameFile{ false };
+
+	for (size_t i = 0; i < lumpData.size(); ++i)
+	{
+		LumpData& data{ lumpData[i] };
+		if (data.mappedFile == nullptr)
+			continue;
+
+		// Lumps from the same mapping are usually next to each other.
+		if (data.mappedFile.get() != lastChecked)
+		{
+			lastChecked = data.mappedFile.get();
+			isSameFile = std::filesystem::equivalent((*lastChecked).getFileName(), target, error);
+		}
+
+		if (isSameFile)
+			data.getMutableData(lumpSizes[i]);
+	}
 }
 
 WadType WadFormat::getWADType() 	{ return wadType; }
@@ -199,9 +1075,10 @@ std::string_view WadFormat::getWADTypeToChar()
 
 void WadFormat::setWADType(WadType newType) { (*this).wadType = newType; }
 
-void WadFormat::compressFile(WadFile& file)
+void WadFormat::compressFile(WadFile file)
 {
-	uint32_t dataSizeForThisFile{ file.dataSize };
+	uint32_t dataSizeForThisFile{ file.getSize() };
+	const char* fileData{ file.getData() };
 
 	std::vector<char> compressedBinary{};
 	compressedBinary.resize(dataSizeForThisFile + 4);
@@ -220,26 +1097,26 @@ void WadFormat::compressFile(WadFile& file)
 			compressedBinary[i] = 0;
 		}
 
-		compressedBinary.insert(compressedBinary.begin() + 4,
-			file.binaryData.begin(), file.binaryData.end());
+		std::copy(fileData, fileData + dataSizeForThisFile, compressedBinary.begin() + 4);
 
-		file.dataSize 	+= 4;
-		file.binaryData = std::move(compressedBinary);
+		file.setSize(dataSizeForThisFile + 4);
+		(*this).setLumpData(file.getIndex(), std::move(compressedBinary));
 	}
 	else
 	{
-		unsigned int compressedSize = lzf_compress(&file.binaryData[0], file.dataSize,
-			(compressedBinary.begin() + 4).base(), file.dataSize - 1);
+		unsigned int compressedSize = lzf_compress(fileData, dataSizeForThisFile,
+			(compressedBinary.begin() + 4).base(), dataSizeForThisFile - 1);
 
-		if (compressedSize == 0 && errno == 0) // buffer too small.
+		// Buffer too small, it doesn't compress. lzf_compress never sets errno,
+		// so whatever's in it is left over from something else and means nothing.
+		if (compressedSize == 0)
 		{
 			for (size_t i = 0; i < 4; i++)
 				compressedBinary[i] = 0;
 
-			compressedBinary.insert(compressedBinary.begin() + 4,
-				file.binaryData.begin(), file.binaryData.end());
+			std::copy(fileData, fileData + dataSizeForThisFile, compressedBinary.begin() + 4);
 
-			file.dataSize	+= 4;
+			file.setSize(dataSizeForThisFile + 4);
 		}
 		else
 		{
@@ -250,10 +1127,10 @@ void WadFormat::compressFile(WadFile& file)
 			}
 
 			// + 4 for the data bytes that indicate uncompressed size
-			file.dataSize 	= compressedSize + 4; 
+			file.setSize(compressedSize + 4);
 		}
 
-		file.binaryData = std::move(compressedBinary);
+		(*this).setLumpData(file.getIndex(), std::move(compressedBinary));
 	}
 }
 
@@ -267,21 +1144,39 @@ bool WadFormat::compressWAD()
 		return false;
 	}
 
-	// We're pretty much assuming here that every file is uncompressed.
-	for (size_t i = 0; i < (*this).getNumFiles(); ++i)
+	if (!lumpDataLoaded)
 	{
-		WadFile& file = (*this)[i];
-		(*this).compressFile(file);
+		std::cerr << "Can't compress a WAD whose lumps were never read. Quitting early.\n";
+		return false;
 	}
 
+	// We're pretty much assuming here that every file is uncompressed.
+	(*this).runOnEveryLumpWithin([this](uint32_t index) { (*this).compressFile((*this)[index]); },
+		[this](uint32_t index) { return static_cast<uint64_t>(lumpSizes[index]) + 4; });
+
 	(*this).setWADType(WadType::ZWAD);
+
+	if constexpr (DEBUG)
+	{
+		if (lumpArena != nullptr)
+			std::cout << "Compressed " << wadNumFiles << " lumps into " << (*lumpArena).getNumBlocks() <<
+				" arena blocks, " << (*lumpArena).getNumStored() << " lumps stored so far.\n";
+	}
+
 	return true;
 }
 
-void WadFormat::decompressFile(WadFile& file)
+void WadFormat::decompressFile(WadFile file)
 {
+	const uint32_t dataSize{ file.getSize() };
+	LumpData& data{ file.getLumpData() };
+
+	// Not even enough room for the size, so there's nothing to do.
+	if (dataSize < 4)
+		return;
+
 	uint32_t uncompressedSize{ 0 };
-	std::memcpy(&uncompressedSize, &file.binaryData[0], sizeof(uint32_t));
+	std::memcpy(&uncompressedSize, file.getData(), sizeof(uint32_t));
 
 	// std::cout << "Size: " << uncompressedSize << '\n';
 
@@ -293,9 +1188,9 @@ void WadFormat::decompressFile(WadFile& file)
 			the lump is not compressed, and you can subtract
 			four from the size given in the wadfile directory.
 		*/
-		file.binaryData.insert(file.binaryData.begin(),
-			file.binaryData.begin() + 4, file.binaryData.end());
-		file.dataSize -= 4;
+		data.mappedData += 4; // Nothing to copy, just skip the size.
+
+		file.setSize(dataSize - 4);
 	}
 	else
 	{
@@ -306,11 +1201,11 @@ void WadFormat::decompressFile(WadFile& file)
 		std::vector<char> uncompressedBinary{};
 		uncompressedBinary.resize(uncompressedSize);
 
-		lzf_decompress(&file.binaryData[4], file.dataSize,
+		lzf_decompress(data.getData() + 4, dataSize - 4,
 			uncompressedBinary.begin().base(), uncompressedSize);
 
-		file.dataSize 	= uncompressedSize;
-		file.binaryData = std::move(uncompressedBinary);
+		file.setSize(uncompressedSize);
+		(*this).setLumpData(file.getIndex(), std::move(uncompressedBinary));
 	}
 }
 
@@ -322,37 +1217,79 @@ bool WadFormat::decompressWAD(WadType newType)
 		return false;
 	}
 
-	for (size_t i = 0; i < (*this).getNumFiles(); ++i)
+	if (!lumpDataLoaded)
 	{
-		WadFile& file = (*this)[i];
-		(*this).decompressFile(file);
+		std::cerr << "Can't decompress a WAD whose lumps were never read. Quitting early.\n";
+		return false;
 	}
 
+	(*this).runOnEveryLumpWithin([this](uint32_t index) { (*this).decompressFile((*this)[index]); },
+		[this](uint32_t index)
+		{
+			// Stored lumps don't need any new memory, compressed ones
+			// say how big they'll get.
+			uint32_t uncompressedSize{ 0 };
+			if (lumpSizes[index] >= 4)
+				std::memcpy(&uncompressedSize, lumpData[index].getData(), sizeof(uint32_t));
+
+			return static_cast<uint64_t>(uncompressedSize);
+		});
+
 	(*this).setWADType(newType);
+
+	if constexpr (DEBUG)
+	{
+		if (lumpArena != nullptr)
+			std::cout << "Decompressed " << wadNumFiles << " lumps into " << (*lumpArena).getNumBlocks() <<
+				" arena blocks, " << (*lumpArena).getNumStored() << " lumps stored so far.\n";
+	}
+
 	return true;
 }
 
 bool WadFormat::addFileToWAD(std::string_view filename, std::string_view newname, bool override)
 {
-	std::ifstream newFile{ filename.data(), std::ios_base::binary };
-	if (newFile.fail())
-		return false;
+	// Mapped, so adding big files doesn't mean holding all of them in memory.
+	LumpData newData{};
+	uint64_t fileSize{ 0 };
+
+	std::shared_ptr<MappedFile> mapping{ std::make_shared<MappedFile>() };
+	if ((*mapping).openFile(filename))
+	{
+		fileSize = (*mapping).getSize();
+		newData.mappedFile = std::move(mapping);
+		newData.mappedData = (*newData.mappedFile).getData();
+	}
+	else
+	{
+		std::ifstream newFile{ filename.data(), std::ios_base::binary };
+		if (newFile.fail())
+			return false;
 
-	// Getting size for binary vector.
-	newFile.seekg(0, std::ios::end);
-	const uint32_t dataSize{ static_cast<uint32_t>(newFile.tellg()) };
-	newFile.seekg(0, std::ios::beg);
+		// Getting size for binary vector.
+		newFile.seekg(0, std::ios::end);
+		fileSize = static_cast<uint64_t>(newFile.tellg());
+		newFile.seekg(0, std::ios::beg);
+
+		// Dunking all of the info in.
+		std::vector<char> binary{};
+		binary.resize(fileSize);
+		newFile.read(binary.data(), fileSize);
+		newData.setData(std::move(binary));
+	}
 
-	// Creating and resizing vector
-	std::vector<char> binary{};
-	binary.resize(dataSize);
+	if (fileSize > UINT32_MAX)
+	{
+		std::cerr << "addFileToWAD: " << filename << " is too big to fit in a WAD.\n";
+		return false;
+	}
 
-	// Dunking all of the info in.
-	newFile.read(&binary[0], dataSize);
+	const uint32_t dataSize{ static_cast<uint32_t>(fileSize) };
 
 	// Get offset.
-	WadFile& lastFile{ (*this)[(*this).wadNumFiles] };
-	const uint32_t dataOffset{ lastFile.dataOffset + lastFile.dataSize };
+	uint32_t dataOffset{ 12 };
+	if (wadNumFiles > 0)
+		dataOffset = lumpOffsets.back() + lumpSizes.back();
 
 	// Do we care about the name?
 	std::string inputname;
@@ -387,35 +1324,30 @@ bool WadFormat::addFileToWAD(std::string_view filename, std::string_view newname
 		std::cout << "string: " 	<< inputname << '\n';
 		std::cout << "size: " 		<< dataSize << '\n';
 		std::cout << "inputname: " 	<< inputname << '\n';
-		std::cout << "wad size: " 	<< wadFiles.size() << '\n';
+		std::cout << "wad size: " 	<< wadNumFiles << '\n';
 	}
 
 	unsigned int addIndex{ (*this).wadNumFiles };
+	int existingIndex{ -1 };
 
+	// Find a file with the same name as the file we're adding
 	if (override)
+		existingIndex = (*this).findFileByName(inputname);
+
+	if (existingIndex != -1)
 	{
-		// Find a file with the same name as the file we're adding
-		for (size_t i = 0; i < (*this).wadNumFiles; i++)
-		{
-			if (inputname == (*this)[i].name)
-			{
-				// Found it, let's replace it.
-				addIndex = i;
-				break;
-			}
-		}
+		// Found it, let's replace it. Same name, so the index doesn't change.
+		addIndex = static_cast<unsigned int>(existingIndex);
+		lumpOffsets[addIndex]	= dataOffset;
+		lumpSizes[addIndex]		= dataSize;
+		lumpData[addIndex]		= std::move(newData);
 	}
-
-	// Add the new file in...
-	if (!override)
+	else
 	{
-		// +1 files.
-		(*this).wadNumFiles++;
-		wadFiles.resize((*this).wadNumFiles);
+		// Add the new file in...
+		(*this).appendLump(WadFormat::packLumpName(inputname), dataOffset, dataSize, std::move(newData));
 	}
 
-	wadFiles[addIndex] = { dataOffset, dataSize, inputname, std::move(binary) };
-
 	// Compress if this is a ZWAD.
 	if ((*this).getWADType() == WadType::ZWAD)
 		(*this).compressFile((*this)[addIndex]);
@@ -423,63 +1355,129 @@ bool WadFormat::addFileToWAD(std::string_view filename, std::string_view newname
 	return true;
 }
 
-void WadFormat::addFileToWAD(WadFile& newFile)
+void WadFormat::addFileToWAD(WadFile newFile)
 {
-	uint32_t sizeOffset{ 0 };
-	for (WadFile& file : (*this).wadFiles)
-		sizeOffset += file.dataSize;
-
-	(*this).wadFiles.push_back({sizeOffset, newFile.dataSize, newFile.name, std::move(newFile.binaryData)});
-
-	(*this).wadNumFiles++;
+	(*this).appendLump(newFile.getPackedName(), (*this).getEndOfData(), newFile.getSize(),
+		std::move(newFile.getLumpData()));
 }
 
 void WadFormat::removeFileByIndex(const unsigned int index)
 {
-	uint32_t deletedFileSize{ (*this)[index].dataSize };
-	(*this).wadFiles.erase((*this).wadFiles.begin() + index);
+	uint32_t deletedFileSize{ lumpSizes[index] };
+	lumpNames.erase(lumpNames.begin() + index);
+	lumpOffsets.erase(lumpOffsets.begin() + index);
+	lumpSizes.erase(lumpSizes.begin() + index);
+	lumpData.erase(lumpData.begin() + index);
 	(*this).wadNumFiles--;
 
-	// Set offset to the files preceeding it now that it does not exist.
-	for (size_t i = index; i < (*this).getNumFiles(); i++)
-		(*this)[index].dataOffset -= deletedFileSize;
+	// Set offset to the files preceeding it now that it does not exist.
+	for (size_t i = index; i < (*this).getNumFiles(); i++)
+		lumpOffsets[i] -= deletedFileSize;
+
+	// Everything after it moved up one, so the indices are all off.
+	(*this).rebuildNameIndex();
+}
+
+bool WadFormat::removeFileByName(std::string_view filename)
+{
+	return (*this).removeLumps({ { SelectType::BY_NAME, std::string{ filename }, 0 } })[0];
+}
+
+std::vector<uint8_t> WadFormat::removeLumps(const std::vector<LumpSelector>& selectors)
+{
+	std::vector<uint8_t> results{};
+	results.resize(selectors.size(), false);
+
+	// Mark everything first, nothing moves until they're all found.
+	std::vector<uint8_t> removed{};
+	removed.resize(wadNumFiles, false);
+	bool anyRemoved{ false };
+
+	// All the patterns get looked for together.
+	std::vector<const LumpPattern*> patterns{};
+	for (const LumpSelector& selector : selectors)
+	{
+		if (selector.type == SelectType::BY_PATTERN)
+			patterns.push_back(selector.pattern);
+	}
+
+	const std::vector<std::vector<unsigned int>> patternMatches{ (*this).findLumpsMatching(patterns) };
+	size_t patternAt{ 0 };
+
+	for (size_t i = 0; i < selectors.size(); ++i)
+	{
+		const LumpSelector& selector{ selectors[i] };
+		if (selector.type == SelectType::BY_INDEX)
+		{
+			if (selector.index < wadNumFiles)
+				removed[selector.index] = results[i] = true;
+		}
+		else if (selector.type == SelectType::BY_PATTERN)
+		{
+			for (unsigned int index : patternMatches[patternAt++])
+				removed[index] = results[i] = true;
+		}
+		else
+		{
+			for (unsigned int index : (*this).findFilesByName(selector.name))
+				removed[index] = results[i] = true;
+		}
+
+		anyRemoved |= static_cast<bool>(results[i]);
+	}
+
+	if (anyRemoved)
+		(*this).compactLumps(removed);
+
+	return results;
 }
 
-bool WadFormat::removeFileByName(std::string_view filename)
+void WadFormat::compactLumps(const std::vector<uint8_t>& removed)
 {
-	size_t i{ 0 };
-	bool success{ false };
-
-	for (WadFile& file : wadFiles)
+	// Same thing removeFileByIndex does, but for all of them at once:
+	// everything after a removed lump moves up by its size.
+	uint32_t removedSize{ 0 };
+	uint32_t kept{ 0 };
+	for (uint32_t index = 0; index < wadNumFiles; ++index)
 	{
-		if (filename == file.name.c_str())
+		if (removed[index])
+		{
+			removedSize += lumpSizes[index];
+			continue;
+		}
+
+		if (kept != index)
 		{
-			success = true;
-			(*this).removeFileByIndex(i);
+			lumpNames[kept] = lumpNames[index];
+			lumpSizes[kept] = lumpSizes[index];
+			lumpData[kept] = std::move(lumpData[index]);
 		}
-		++i;
+		lumpOffsets[kept] = lumpOffsets[index] - removedSize;
+		kept++;
 	}
 
-	return success;
+	lumpNames.resize(kept);
+	lumpOffsets.resize(kept);
+	lumpSizes.resize(kept);
+	lumpData.resize(kept);
+	(*this).wadNumFiles = kept;
+
+	(*this).rebuildNameIndex();
 }
 
 void WadFormat::createMarkers(std::string_view markerName)
 {
-	uint32_t sizeOffset{ 0 };
-	for (WadFile& file : (*this).wadFiles)
-		sizeOffset += file.dataSize;
+	uint32_t sizeOffset{ (*this).getEndOfData() };
 	
 	std::string markerNewNames{ markerName };
 	markerNewNames += "_START";
 
-	(*this).wadFiles.push_back({sizeOffset, 0, markerNewNames, std::vector<char>{}});
+	(*this).appendLump(WadFormat::packLumpName(markerNewNames), sizeOffset, 0, LumpData{});
 
 	markerNewNames = markerName;
 	markerNewNames += "_END";
 
-	(*this).wadFiles.push_back({sizeOffset, 0, markerNewNames, std::vector<char>{}});
-
-	(*this).wadNumFiles += 2;
+	(*this).appendLump(WadFormat::packLumpName(markerNewNames), sizeOffset, 0, LumpData{});
 }
 
 std::string_view WadFormat::determineFormatFromFileName(std::string_view fileName)
@@ -503,6 +1501,96 @@ std::string_view WadFormat::determineFormatFromFileName(std::string_view fileNam
 	return ".lmp";
 }
 
+bool WadFormat::findMarkerRange(std::string_view markerName, MarkerRange& range)
+{
+	range = MarkerRange{};
+
+	// Doubled-up markers (FF_START, SS_END...) belong to the same namespace as the
+	// single ones, and PWADs love mixing them, like FF_START with F_END.
+	std::string prefix{ markerName };
+	if (prefix.size() == 2 && prefix[0] == prefix[1])
+		prefix.resize(1);
+	const std::string doubled{ prefix + prefix };
+
+	// All straight from the name index, no need to go through the whole list.
+	const auto firstOf{ [this](std::string_view name, std::string_view otherName, int after) -> int
+		{
+			int first{ -1 };
+			for (std::string_view lumpName : { name, otherName })
+			{
+				const std::vector<unsigned int>& indices{ (*this).findFilesByName(lumpName) };
+				auto it{ std::upper_bound(indices.begin(), indices.end(), after,
+					[](int value, unsigned int index) { return value < static_cast<int>(index); }) };
+
+				if (it != indices.end() && (first == -1 || static_cast<int>(*it) < first))
+					first = static_cast<int>(*it);
+			}
+
+			return first;
+		} };
+
+	range.start = firstOf(prefix + "_START", doubled + "_START", -1);
+	range.end = firstOf(prefix + "_END", doubled + "_END", range.start);
+
+	// An _END with no _START before it still works, like it always has.
+	if (range.end == -1 && range.start != -1)
+	{
+		range.start = -1;
+		range.end = firstOf(prefix + "_END", doubled + "_END", -1);
+	}
+
+	return range.end != -1;
+}
+
+bool WadFormat::moveLumpsWithin(std::string_view markerName, const std::vector<unsigned int>& indices,
+	std::vector<unsigned int>& newPositions)
+{
+	newPositions.clear();
+
+	MarkerRange range{};
+	if (!(*this).findMarkerRange(markerName, range))
+		return false;
+
+	// The same lump twice only moves once.
+	std::vector<uint8_t> moving{};
+	moving.resize(wadNumFiles, false);
+
+	std::vector<uint32_t> moved{};
+	for (unsigned int index : indices)
+	{
+		if (index < wadNumFiles && !moving[index] && static_cast<int>(index) != range.end)
+		{
+			moving[index] = true;
+			moved.push_back(index);
+		}
+	}
+
+	// Everything else stays in order, the moved ones go in right before the _END marker.
+	std::vector<uint32_t> newOrder{};
+	newOrder.reserve(wadNumFiles);
+	for (uint32_t index = 0; index < wadNumFiles; ++index)
+	{
+		if (static_cast<int>(index) == range.end)
+			newOrder.insert(newOrder.end(), moved.begin(), moved.end());
+
+		if (!moving[index])
+			newOrder.push_back(index);
+	}
+
+	std::vector<unsigned int> positionOf{};
+	positionOf.resize(wadNumFiles);
+	for (uint32_t position = 0; position < wadNumFiles; ++position)
+		positionOf[newOrder[position]] = position;
+
+	for (unsigned int index : indices)
+		newPositions.push_back(index < wadNumFiles ? positionOf[index] : UINT_MAX);
+
+	if (!moved.empty())
+		(*this).reorderLumps(newOrder);
+
+	return true;
+}
+
 void WadFormat::trimStringToMarkerCharacters(std::string& markerName)
 {
 	bool foundUnderscore{ false };
@@ -528,25 +1616,20 @@ void WadFormat::trimStringToMarkerCharacters(std::string& markerName)
 		markerName = markerName.substr(0, 2);
 }
 
-bool WadFormat::extractLump(WadFile& file, bool noExtension, std::string_view path)
+bool WadFormat::extractLump(WadFile file, bool noExtension, std::string_view path)
 {
+	if (!lumpDataLoaded)
+	{
+		std::cerr << "extractLump: Only the file list of this WAD was read.\n";
+		return false;
+	}
+
 	// We should give these an extension.
-	std::string filename{ file.name };
+	std::string filename{ file.getName() };
 	
+	// Let's add the extension.
 	if (!noExtension)
-	{
-		for (size_t i = 0; i < filename.size(); i++)
-		{
-			if (filename[i] == '\0')
-			{
-				filename.erase(i, filename.size());
-				break;
-			}
-		}
-		
-		// Let's add the extension.
-		filename.append(determineFormatFromFileName(file.name).data());
-	}
+		filename.append(determineFormatFromFileName(filename).data());
 
 	if (!path.empty())
 	{
@@ -559,17 +1642,18 @@ bool WadFormat::extractLump(WadFile& file, bool noExtension, std::string_view pa
 	if (newFile.fail())
 		return false;
 
-	std::vector<char>& binary{ file.binaryData };
-	uint32_t &size{ file.dataSize };
+	const char* binary{ file.getData() };
+	uint32_t size{ file.getSize() };
 	size_t startingIndex{ 0 };
+	std::vector<char> uncompressedBinary{};
 
-	if ((*this).getWADType() == ZWAD)
+	if ((*this).getWADType() == ZWAD && size >= 4)
 	{
 		if constexpr (DEBUG)
 			std::cout << "decompressing this before we do anything...\n";
 
 		uint32_t uncompressedSize{ 0 };
-		std::memcpy(&uncompressedSize, &file.binaryData[0], sizeof(uint32_t));
+		std::memcpy(&uncompressedSize, binary, sizeof(uint32_t));
 
 		if (uncompressedSize == 0)
 		{
@@ -579,66 +1663,72 @@ bool WadFormat::extractLump(WadFile& file, bool noExtension, std::string_view pa
 		}
 		else
 		{
-			std::vector<char> uncompressedBinary{};
+			// The lump itself stays compressed, we only want the output.
 			uncompressedBinary.resize(uncompressedSize);
 
-			lzf_decompress(&file.binaryData[4], file.dataSize,
+			lzf_decompress(binary + 4, size - 4,
 				uncompressedBinary.begin().base(), uncompressedSize);
 
-			binary = uncompressedBinary;
+			binary = uncompressedBinary.data();
 			size = uncompressedSize;
 		}
 	}
 
-	newFile.write(&binary[startingIndex], size - startingIndex);
+	newFile.write(binary + startingIndex, size - startingIndex);
 
 	newFile.close();
 	return true;
 }
 
-bool WadFormat::swapLumpPosByName(std::string_view name1, std::string_view name2)
+std::vector<uint8_t> WadFormat::extractAllLumps(bool noExtension, std::string_view path)
 {
-	int index1{ -1 };
-	int index2{ -1 };
+	// Not a vector<bool>, threads write to it side by side.
+	std::vector<uint8_t> extracted{};
+	extracted.resize(wadNumFiles, 0);
 
-	for (size_t i = 0; i < (*this).getNumFiles(); i++)
-	{
-		if (strcmp((*this)[i].name.c_str(), name1.data()) == 0)
-			index1 = i;
-		else if (strcmp((*this)[i].name.c_str(), name2.data()) == 0)
-			index2 = i;
+	// Lumps with the same name end up in the same file, and only the last one
+	// would survive anyway. Writing just that one keeps threads from racing.
+	std::vector<uint32_t> lastOfEachName{};
+	lastOfEachName.reserve(lumpNameIndex.size());
+	for (auto& [name, indices] : lumpNameIndex)
+		lastOfEachName.push_back(indices.back());
 
-		if (index1 != -1 && index2 != -1)
-			break;
+	(*this).runOnLumps(lastOfEachName, [this, &extracted, noExtension, path](uint32_t index)
+		{ extracted[index] = (*this).extractLump((*this)[index], noExtension, path); });
+
+	for (auto& [name, indices] : lumpNameIndex)
+	{
+		for (unsigned int index : indices)
+			extracted[index] = extracted[indices.back()];
 	}
-	
-	if (index1 == -1 || index2 == -1)
-		return false;
 
-	swapLumpPosByIndex(static_cast<unsigned int>(index1),
-		static_cast<unsigned int>(index2));
+	return extracted;
+}
 
-	return true;
+bool WadFormat::swapLumpPosByName(std::string_view name1, std::string_view name2)
+{
+	// Same lumps as a batch of one would pick.
+	return (*this).moveLumps({ { MoveType::SWAP_WITH, std::string{ name1 }, std::string{ name2 }, 0, false } })[0];
 }
 
 void WadFormat::swapLumpPosByIndex(unsigned int index1, unsigned int index2)
 {
-	WadFile temp{ std::move((*this)[index2]) };
-	(*this)[index2] = (*this)[index1];
-	(*this)[index1] =  std::move(temp);
+	// Only the entries change places, the lumps' bytes stay where they are.
+	std::swap(lumpNames[index1], lumpNames[index2]);
+	std::swap(lumpOffsets[index1], lumpOffsets[index2]);
+	std::swap(lumpSizes[index1], lumpSizes[index2]);
+	std::swap(lumpData[index1], lumpData[index2]);
+
+	if (lumpNames[index1] == lumpNames[index2])
+		return;
+
+	(*this).reindexLump(lumpNames[index1], index2, index1);
+	(*this).reindexLump(lumpNames[index2], index1, index2);
 }
 
 bool WadFormat::moveLumpPosByName(std::string_view name1, int position, bool relative)
 {
-	int index{ -1 };
-	for (size_t i = 0; i < (*this).getNumFiles(); i++)
-	{
-		if (strcmp((*this)[i].name.c_str(), name1.data()) == 0)
-		{
-			index = i;
-			break;
-		}
-	}
+	int index{ (*this).findFileByName(name1) };
 
 	if (index == -1) // couldn't find it
 		return false;
@@ -648,43 +1738,596 @@ bool WadFormat::moveLumpPosByName(std::string_view name1, int position, bool rel
 
 bool WadFormat::moveLumpPosByIndex(unsigned int index, int position, bool relative)
 {
-	int finalIndex = relative ? index + position : position;
+	const int64_t finalIndex{ relative ? static_cast<int64_t>(index) + position : position };
 	// check if we're not going oob.
-	if (static_cast<unsigned int>(finalIndex) > ((*this).getNumFiles() - 1) || finalIndex < 0)
+	if (finalIndex < 0 || finalIndex >= static_cast<int64_t>((*this).getNumFiles()))
 		return false;
 
-	std::function doadd 	{ [](int num) -> int { return ++num; } };
-	std::function dominus 	{ [](int num) -> int { return --num; } };
+	const size_t from{ index };
+	const size_t to{ static_cast<size_t>(finalIndex) };
+
+	// Everything in between shifts over by one to make room.
+	const auto rotateLump{ [from, to](auto& list)
+		{
+			if (from < to)
+				std::rotate(list.begin() + from, list.begin() + from + 1, list.begin() + to + 1);
+			else
+				std::rotate(list.begin() + to, list.begin() + from, list.begin() + from + 1);
+		} };
+
+	rotateLump(lumpNames);
+	rotateLump(lumpOffsets);
+	rotateLump(lumpSizes);
+	rotateLump(lumpData);
+
+	if (from != to)
+		(*this).rebuildNameIndex();
+
+	return true;
+}
+
+namespace
+{
+	// The order of the lumps while a batch of moves is worked out.
+	// It's a treap ordered by position, so finding a lump's position and
+	// moving it anywhere else are both O(log n), however far it goes.
+	class LumpOrder
+	{
+	public:
+		LumpOrder(uint32_t numLumps)
+			: left(numLumps, none), right(numLumps, none), parent(numLumps, none),
+			size(numLumps, 1), priority(numLumps), root{ none }
+		{
+			// Fixed seed, the same moves always make the same tree.
+			std::mt19937 random{ numLumps };
+			for (uint32_t& value : priority)
+				value = random();
+
+			// Lumps are already in order, so the tree can be built in one go
+			// instead of inserting them one by one.
+			std::vector<uint32_t> rightEdge{};
+			for (uint32_t lump = 0; lump < numLumps; ++lump)
+			{
+				uint32_t lastPopped{ none };
+				while (!rightEdge.empty() && priority[rightEdge.back()] < priority[lump])
+				{
+					lastPopped = rightEdge.back();
+					rightEdge.pop_back();
+				}
+
+				(*this).attach(lump, lastPopped, true);
+				if (!rightEdge.empty())
+					(*this).attach(rightEdge.back(), lump, false);
+
+				rightEdge.push_back(lump);
+			}
+
+			root = rightEdge.empty() ? none : rightEdge.front();
+			(*this).updateSizes(root);
+		}
+
+		uint32_t getPosition(uint32_t lump)
+		{
+			uint32_t position{ (*this).sizeOf(left[lump]) };
+			for (uint32_t node = lump; parent[node] != none; node = parent[node])
+			{
+				if (right[parent[node]] == node)
+					position += (*this).sizeOf(left[parent[node]]) + 1;
+			}
+
+			return position;
+		}
+
+		void moveLump(uint32_t lump, uint32_t newPosition)
+		{
+			uint32_t before{ none }, rest{ none }, moved{ none }, after{ none };
+
+			(*this).split(root, (*this).getPosition(lump), before, rest);
+			(*this).split(rest, 1, moved, after);
+			root = (*this).merge(before, after);
+
+			(*this).split(root, newPosition, before, after);
+			root = (*this).merge((*this).merge(before, moved), after);
+			parent[root] = none;
+		}
+
+		std::vector<uint32_t> getOrder()
+		{
+			std::vector<uint32_t> order{};
+			order.reserve(size.size());
+
+			std::vector<uint32_t> path{};
+			uint32_t node{ root };
+			while (node != none || !path.empty())
+			{
+				for (; node != none; node = left[node])
+					path.push_back(node);
+
+				node = path.back();
+				path.pop_back();
+				order.push_back(node);
+				node = right[node];
+			}
+
+			return order;
+		}
+
+	private:
+		static constexpr uint32_t none{ UINT32_MAX };
+
+		std::vector<uint32_t> left;
+		std::vector<uint32_t> right;
+		std::vector<uint32_t> parent;
+		std::vector<uint32_t> size;
+		std::vector<uint32_t> priority;
+		uint32_t root;
+
+		uint32_t sizeOf(uint32_t node) { return node == none ? 0 : size[node]; }
+
+		void attach(uint32_t node, uint32_t child, bool asLeft)
+		{
+			(asLeft ? left : right)[node] = child;
+			if (child != none)
+				parent[child] = node;
+		}
+
+		void updateSize(uint32_t node)
+		{
+			size[node] = (*this).sizeOf(left[node]) + (*this).sizeOf(right[node]) + 1;
+		}
+
+		void updateSizes(uint32_t node)
+		{
+			if (node == none)
+				return;
+
+			(*this).updateSizes(left[node]);
+			(*this).updateSizes(right[node]);
+			(*this).updateSize(node);
+		}
+
+		// The first count lumps end up in first, the rest in second.
+		void split(uint32_t node, uint32_t count, uint32_t& first, uint32_t& second)
+		{
+			first = second = none;
+			if (node == none)
+				return;
+
+			if ((*this).sizeOf(left[node]) < count)
+			{
+				uint32_t splitRight{ none };
+				(*this).split(right[node], count - (*this).sizeOf(left[node]) - 1, splitRight, second);
+				(*this).attach(node, splitRight, false);
+				first = node;
+			}
+			else
+			{
+				uint32_t splitLeft{ none };
+				(*this).split(left[node], count, first, splitLeft);
+				(*this).attach(node, splitLeft, true);
+				second = node;
+			}
+
+			(*this).updateSize(node);
+			if (first != none)
+				parent[first] = none;
+			if (second != none)
+				parent[second] = none;
+		}
+
+		// Everything in first goes before everything in second.
+		uint32_t merge(uint32_t first, uint32_t second)
+		{
+			if (first == none || second == none)
+				return first == none ? second : first;
+
+			if (priority[first] > priority[second])
+			{
+				(*this).attach(first, (*this).merge(right[first], second), false);
+				(*this).updateSize(first);
+				return first;
+			}
+
+			(*this).attach(second, (*this).merge(first, left[second]), true);
+			(*this).updateSize(second);
+			return second;
+		}
+	};
+}
+
+std::vector<uint8_t> WadFormat::moveLumps(const std::vector<LumpMove>& moves)
+{
+	std::vector<uint8_t> results{};
+	results.resize(moves.size(), false);
+
+	if (wadNumFiles == 0)
+		return results;
+
+	// Nothing moves for real until the end, so lumps keep their indices
+	// (and the name index stays right) while the new order gets worked out.
+	LumpOrder order{ wadNumFiles };
+	bool anyMoved{ false };
+
+	// Same as findFileByName, but with the lumps in their new order.
+	const auto findFirst{ [this, &order](std::string_view name) -> int64_t
+		{
+			int64_t first{ -1 };
+			uint32_t firstPosition{ UINT32_MAX };
+			for (unsigned int index : (*this).findFilesByName(name))
+			{
+				const uint32_t position{ order.getPosition(index) };
+				if (position < firstPosition)
+				{
+					first = index;
+					firstPosition = position;
+				}
+			}
+
+			return first;
+		} };
 
-	std::function ishigher	{ [](int num1, int num2) -> bool { return num1 > num2; } };
-	std::function islower 	{ [](int num1, int num2) -> bool { return num1 < num2; } };
+	// The lump with that name closest before a position, or fallback if there isn't one.
+	const auto findLastBefore{ [this, &order](std::string_view name, uint32_t before, int64_t fallback) -> int64_t
+		{
+			int64_t last{ fallback };
+			uint32_t lastPosition{ 0 };
+			for (unsigned int index : (*this).findFilesByName(name))
+			{
+				const uint32_t position{ order.getPosition(index) };
+				if (position < before && (last == fallback || position > lastPosition))
+				{
+					last = index;
+					lastPosition = position;
+				}
+			}
 
-	// if index is higher, we wanna go up
-	std::function<int(int)>& 		arithmetic 	= dominus;
-	std::function<bool(int, int)>& 	condition 	= ishigher;
+			return last;
+		} };
 
-	if (index < static_cast<unsigned int>(finalIndex)) // if index is lower, we wanna go down
+	for (size_t i = 0; i < moves.size(); ++i)
 	{
-		arithmetic	= doadd;
-		condition	= islower;
+		const LumpMove& move{ moves[i] };
+		int64_t lump{ findFirst(move.name) };
+		if (lump == -1)
+			continue;
+
+		uint32_t position{ order.getPosition(static_cast<uint32_t>(lump)) };
+
+		if (move.type == MoveType::SWAP_WITH)
+		{
+			int64_t otherLump{ findFirst(move.otherName) };
+			if (otherLump == -1 || otherLump == lump || move.name == move.otherName)
+				continue;
+
+			uint32_t otherPosition{ order.getPosition(static_cast<uint32_t>(otherLump)) };
+
+			// Swaps always went through the lumps once, keeping the latest lump for each
+			// name until both had one. So whichever name shows up first gets its last lump
+			// from before the other name's first one, which matters with duplicates.
+			if (position < otherPosition)
+				lump = findLastBefore(move.name, otherPosition, lump);
+			else
+				otherLump = findLastBefore(move.otherName, position, otherLump);
+
+			position = order.getPosition(static_cast<uint32_t>(lump));
+			otherPosition = order.getPosition(static_cast<uint32_t>(otherLump));
+			const uint32_t firstLump{ static_cast<uint32_t>(position < otherPosition ? lump : otherLump) };
+			const uint32_t secondLump{ static_cast<uint32_t>(position < otherPosition ? otherLump : lump) };
+
+			// The second one goes where the first one is, which pushes the first
+			// one over by one, and then the first one goes where the second was.
+			order.moveLump(secondLump, std::min(position, otherPosition));
+			order.moveLump(firstLump, std::max(position, otherPosition));
+		}
+		else
+		{
+			const int64_t finalPosition{ move.relative ? static_cast<int64_t>(position) + move.position : move.position };
+			if (finalPosition < 0 || finalPosition >= static_cast<int64_t>(wadNumFiles))
+				continue;
+
+			order.moveLump(static_cast<uint32_t>(lump), static_cast<uint32_t>(finalPosition));
+		}
+
+		results[i] = true;
+		anyMoved = true;
 	}
 
-	for (int i = index; condition(i, finalIndex); i = arithmetic(i))
+	if (anyMoved)
+		(*this).reorderLumps(order.getOrder());
+
+	return results;
+}
+
+void WadFormat::reorderLumps(const std::vector<uint32_t>& newOrder)
+{
+	// newOrder[i] is the lump that goes in position i.
+	const auto reorder{ [&newOrder](auto& list)
+		{
+			std::remove_reference_t<decltype(list)> reordered{};
+			reordered.reserve(list.size());
+
+			for (uint32_t index : newOrder)
+				reordered.push_back(std::move(list[index]));
+
+			list = std::move(reordered);
+		} };
+
+	reorder(lumpNames);
+	reorder(lumpOffsets);
+	reorder(lumpSizes);
+	reorder(lumpData);
+
+	(*this).rebuildNameIndex();
+}
+
+void WadFormat::renameFileByIndex(const unsigned int index, std::string_view newName)
+{
+	(*this).unindexLump(index);
+	lumpNames[index] = WadFormat::packLumpName(newName);
+	(*this).indexLump(index);
+}
+
+std::vector<std::vector<unsigned int>> WadFormat::findLumpsMatching(const std::vector<const LumpPattern*>& patterns)
+{
+	std::vector<std::vector<unsigned int>> matches{};
+	matches.resize(patterns.size());
+
+	// Where in the file list each pattern gets to look: [first, last) pieces, in order.
+	std::vector<std::vector<std::pair<uint32_t, uint32_t>>> lookIn{};
+	lookIn.resize(patterns.size());
+	std::vector<size_t> scanning{};
+
+	for (size_t p = 0; p < patterns.size(); ++p)
 	{
-		int newIndex = arithmetic(i);
+		const LumpPattern& pattern{ *patterns[p] };
+		if (!pattern.canMatch())
+			continue;
 
-		if constexpr (DEBUG) 
-			std::cout << "i: " << i << " - " << "newIndex: " << newIndex << '\n';
+		if (pattern.isExactName())
+		{
+			matches[p] = (*this).findFilesByName(pattern.getName());
+			continue;
+		}
+
+		std::vector<std::pair<uint32_t, uint32_t>>& pieces{ lookIn[p] };
+		if (pattern.hasIndexRange())
+		{
+			if (pattern.getFirstIndex() < wadNumFiles)
+				pieces.push_back({ pattern.getFirstIndex(), std::min(pattern.getLastIndex() + 1, wadNumFiles) });
+		}
+		else if (pattern.hasScope())
+		{
+			// Every FROM counts, up to the first TO after it. FROMs before
+			// the same TO would overlap, so they join the piece before them.
+			const std::vector<unsigned int>& ends{ (*this).findFilesByName(pattern.getScopeEnd()) };
+			for (unsigned int start : (*this).findFilesByName(pattern.getScopeStart()))
+			{
+				auto end{ std::upper_bound(ends.begin(), ends.end(), start) };
+				if (end == ends.end())
+					break;
+
+				if (!pieces.empty() && start < pieces.back().second)
+					continue;
+
+				pieces.push_back({ start + 1, *end });
+			}
+		}
+		else
+			pieces.push_back({ 0, wadNumFiles });
 
-		(*this).swapLumpPosByIndex(i, newIndex);
+		if (!pieces.empty())
+			scanning.push_back(p);
 	}
 
-	return true;
+	if (scanning.empty())
+		return matches;
+
+	// One go over the names for all of them, a block at a time so the names are
+	// still in cache for every pattern. Each one skips along its own pieces, lets
+	// NameScan find the names its mask allows, and only looks closer if it has to.
+	static constexpr uint32_t blockSize{ 4096 };
+	std::vector<size_t> pieceAt{};
+	pieceAt.resize(patterns.size(), 0);
+	std::vector<unsigned int> candidates{};
+
+	for (uint32_t blockStart = 0; blockStart < wadNumFiles; blockStart += std::min(blockSize, wadNumFiles - blockStart))
+	{
+		const uint32_t blockEnd{ blockStart + std::min(blockSize, wadNumFiles - blockStart) };
+		for (size_t p : scanning)
+		{
+			const LumpPattern& pattern{ *patterns[p] };
+			const std::vector<std::pair<uint32_t, uint32_t>>& pieces{ lookIn[p] };
+			size_t& at{ pieceAt[p] };
+
+			while (at < pieces.size() && pieces[at].first < blockEnd)
+			{
+				const uint32_t first{ std::max(pieces[at].first, blockStart) };
+				const uint32_t last{ std::min(pieces[at].second, blockEnd) };
+
+				if (pattern.isDecidedByMask())
+					NameScan::findMatching(lumpNames.data(), first, last,
+						pattern.getNameMask(), pattern.getNameValue(), matches[p]);
+				else
+				{
+					candidates.clear();
+					NameScan::findMatching(lumpNames.data(), first, last,
+						pattern.getNameMask(), pattern.getNameValue(), candidates);
+
+					for (unsigned int index : candidates)
+					{
+						if (pattern.matchesName(lumpNames[index]))
+							matches[p].push_back(index);
+					}
+				}
+
+				// It goes on into the next block.
+				if (pieces[at].second > blockEnd)
+					break;
+
+				++at;
+			}
+		}
+	}
+
+	return matches;
+}
+
+int WadFormat::findFileByName(std::string_view name)
+{
+	const std::vector<unsigned int>& matches{ (*this).findFilesByName(name) };
+	return matches.empty() ? -1 : static_cast<int>(matches.front());
+}
+
+const std::vector<unsigned int>& WadFormat::findFilesByName(std::string_view name)
+{
+	static const std::vector<unsigned int> noMatches{};
+
+	// Lump names are 8 characters at most, so a longer one isn't any lump's,
+	// even if it starts like one. Packing it would cut it down to one that is.
+	if (name.substr(0, name.find('\0')).size() > fileNameLength)
+		return noMatches;
+
+	auto found{ lumpNameIndex.find(WadFormat::packLumpName(name)) };
+	return found == lumpNameIndex.end() ? noMatches : (*found).second;
+}
+
+uint64_t WadFormat::packLumpName(std::string_view name)
+{
+	// Lump names are at most 8 characters, and anything after a null
+	// is just padding, so the whole name fits in a single integer.
+	char packedName[fileNameLength]{};
+	for (size_t i = 0; i < name.size() && i < fileNameLength && name[i] != '\0'; ++i)
+		packedName[i] = name[i];
+
+	uint64_t key{ 0 };
+	std::memcpy(&key, packedName, sizeof(key));
+	return key;
+}
+
+std::string WadFormat::unpackLumpName(uint64_t packedName)
+{
+	char name[fileNameLength + 1]{};
+	std::memcpy(name, &packedName, fileNameLength);
+	return std::string{ name };
+}
+
+void WadFormat::indexLump(const unsigned int index)
+{
+	// Keep them sorted, so the first one's always the one nearest to the top.
+	std::vector<unsigned int>& indices{ lumpNameIndex[lumpNames[index]] };
+	indices.insert(std::upper_bound(indices.begin(), indices.end(), index), index);
+}
+
+void WadFormat::unindexLump(const unsigned int index)
+{
+	auto found{ lumpNameIndex.find(lumpNames[index]) };
+	if (found == lumpNameIndex.end())
+		return;
+
+	std::vector<unsigned int>& indices{ (*found).second };
+	auto position{ std::lower_bound(indices.begin(), indices.end(), index) };
+	if (position != indices.end() && *position == index)
+		indices.erase(position);
+
+	if (indices.empty())
+		lumpNameIndex.erase(found);
+}
+
+void WadFormat::reindexLump(uint64_t name, const unsigned int oldIndex, const unsigned int newIndex)
+{
+	auto found{ lumpNameIndex.find(name) };
+	if (found == lumpNameIndex.end())
+		return;
+
+	std::vector<unsigned int>& indices{ (*found).second };
+	auto position{ std::lower_bound(indices.begin(), indices.end(), oldIndex) };
+	if (position == indices.end() || *position != oldIndex)
+		return;
+
+	// Replace it and slide it back into order.
+	*position = newIndex;
+	while (position != indices.begin() && *(position - 1) > *position)
+	{
+		std::iter_swap(position, position - 1);
+		--position;
+	}
+
+	while (position + 1 != indices.end() && *(position + 1) < *position)
+	{
+		std::iter_swap(position, position + 1);
+		++position;
+	}
+}
+
+void WadFormat::rebuildNameIndex()
+{
+	lumpNameIndex.clear();
+	for (unsigned int i = 0; i < lumpNames.size(); ++i)
+		lumpNameIndex[lumpNames[i]].push_back(i);
 }
 
 uint32_t WadFormat::getNumFiles() 	{ return wadNumFiles; }
 uint32_t WadFormat::getFATOffset() 	{ return wadOffFAT; }
 std::string&	WadFormat::getWADName()	{ return wadName; }
-std::vector<WadFile>& WadFormat::getWADLumpList() { return wadFiles; }
-WadFile& WadFormat::getFileFromIndex(const unsigned int index) { return wadFiles[index]; }
-WadFile& WadFormat::operator[](const unsigned int index) { return WadFormat::getFileFromIndex(index); }
\ No newline at end of file
+void WadFormat::setThreadPool(std::shared_ptr<ThreadPool> pool) { threadPool = std::move(pool); }
+std::shared_ptr<ThreadPool> WadFormat::getThreadPool() { return threadPool; }
+void WadFormat::setMaxMemory(uint64_t bytes) { maxMemory = bytes; }
+
+WadFile WadFormat::getFileFromIndex(const unsigned int index) { return WadFile{ *this, index }; }
+WadFile WadFormat::operator[](const unsigned int index) { return WadFormat::getFileFromIndex(index); }
+
+WadFile::WadFile(WadFormat& wad, unsigned int index)
+	: wad{ &wad }, index{ index }
+{
+	// empty.
+}
+
+unsigned int	WadFile::getIndex()			{ return index; }
+std::string		WadFile::getName()			{ return WadFormat::unpackLumpName((*wad).lumpNames[index]); }
+uint64_t		WadFile::getPackedName()	{ return (*wad).lumpNames[index]; }
+uint32_t		WadFile::getOffset()		{ return (*wad).lumpOffsets[index]; }
+uint32_t		WadFile::getSize()			{ return (*wad).lumpSizes[index]; }
+const char*		WadFile::getData()			{ return (*wad).lumpData[index].getData(); }
+LumpData&		WadFile::getLumpData()		{ return (*wad).lumpData[index]; }
+
+void WadFile::setName(std::string_view newName)	{ (*wad).renameFileByIndex(index, newName); }
+void WadFile::setSize(uint32_t newSize)			{ (*wad).lumpSizes[index] = newSize; }
+
+const char* LumpData::getData() { return mappedData; }
+
+char* LumpData::getMutableData(uint32_t dataSize)
+{
+	// Bytes can only be changed in a block that's all ours. Mappings, arena
+	// blocks and anything another lump still points at get copied first.
+	const bool ownsBlock{ mappedFile != nullptr && mappedFile.use_count() == 1 &&
+		(*mappedFile).getWritableData() == mappedData && (*mappedFile).getSize() == dataSize };
+
+	if (!ownsBlock)
+	{
+		std::vector<char> copy{};
+		copy.resize(dataSize);
+		if (mappedData != nullptr)
+			std::copy(mappedData, mappedData + dataSize, copy.begin());
+
+		setData(std::move(copy));
+	}
+
+	return mappedFile != nullptr ? (*mappedFile).getWritableData() : nullptr;
+}
+
+void LumpData::setData(std::vector<char>&& newData)
+{
+	mappedFile.reset();
+	mappedData = nullptr;
+
+	// Nothing to hold on to.
+	if (newData.empty())
+		return;
+
+	std::shared_ptr<MappedFile> block{ std::make_shared<MappedFile>() };
+	if ((*block).adopt(std::move(newData)))
+	{
+		mappedData = (*block).getData();
+		mappedFile = std::move(block);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,304 @@
+/*
+Copyright (c) 2021, JugadorXEI
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice,
+this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <iostream>
+#include <sstream>
+#include <filesystem>
+#include <cstring>
+#include <cerrno>
+#include <csignal>
+
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/time.h>
+#include <unistd.h>
+#endif
+
+#include "headers/wadserver.h"
+
+WadServer::WadServer(size_t maxWADs)
+	: session{}
+{
+	// Every request is like running wadcli on its own, written as soon as it's done.
+	session.setMaxWADs(maxWADs);
+	session.setWriteThrough(true);
+}
+
+#ifdef _WIN32
+bool WadServer::serve(std::string_view /*socketPath*/, std::ostream& out)
+{
+	out << "WADCLI: --serve is not supported on Windows.\n";
+	return false;
+}
+
+int WadServer::runClient(std::string_view /*socketPath*/, const std::vector<std::string>& /*arguments*/,
+	std::ostream& out)
+{
+	out << "WADCLI: --client is not supported on Windows.\n";
+	return 1;
+}
+
+bool WadServer::answerClient(int /*client*/) { return false; }
+#else
+static bool fillSocketAddress(std::string_view socketPath, sockaddr_un& address, std::ostream& out)
+{
+	address = sockaddr_un{};
+	address.sun_family = AF_UNIX;
+
+	if (socketPath.empty() || socketPath.size() >= sizeof(address.sun_path))
+	{
+		out << "WADCLI: " << socketPath << " can't be used as a socket path, it's too long.\n";
+		return false;
+	}
+
+	std::memcpy(address.sun_path, socketPath.data(), socketPath.size());
+	return true;
+}
+
+bool WadServer::serve(std::string_view socketPath, std::ostream& out)
+{
+	sockaddr_un address{};
+	if (!fillSocketAddress(socketPath, address, out))
+		return false;
+
+	const std::string path{ socketPath };
+	const int listener{ socket(AF_UNIX, SOCK_STREAM, 0) };
+	if (listener == -1)
+	{
+		out << "WADCLI: Could not create a socket: " << std::strerror(errno) << '\n';
+		return false;
+	}
+
+	// A socket left behind by a server that's gone gets replaced,
+	// but not one that still has a server on the other end.
+	struct stat status{};
+	if (lstat(path.c_str(), &status) == 0 && S_ISSOCK(status.st_mode))
+	{
+		if (connect(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0)
+		{
+			out << "WADCLI: There's already a server listening on " << socketPath << ".\n";
+			close(listener);
+			return false;
+		}
+
+		unlink(path.c_str());
+	}
+
+	// Only whoever started the server gets to talk to it.
+	const mode_t oldMask{ umask(0077) };
+	const bool bound{ bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0 };
+	umask(oldMask);
+
+	if (!bound || listen(listener, 16) != 0)
+	{
+		out << "WADCLI: Could not listen on " << socketPath << ": " << std::strerror(errno) << '\n';
+		close(listener);
+		return false;
+	}
+
+	// A client that leaves before getting its answer shouldn't take the server with it.
+	std::signal(SIGPIPE, SIG_IGN);
+
+	out << "WADCLI: Listening on " << socketPath << ".\n" << std::flush;
+
+	bool serving{ true };
+	while (serving)
+	{
+		const int client{ accept(listener, nullptr, nullptr) };
+		if (client == -1)
+		{
+			if (errno == EINTR || errno == ECONNABORTED)
+				continue;
+
+			out << "WADCLI: Stopped listening on " << socketPath << ": " << std::strerror(errno) << '\n';
+			break;
+		}
+
+		timeval timeout{};
+		timeout.tv_sec = clientTimeoutSeconds;
+		setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+		setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+		serving = (*this).answerClient(client);
+		close(client);
+	}
+
+	close(listener);
+	unlink(path.c_str());
+	return true;
+}
+
+int WadServer::runClient(std::string_view socketPath, const std::vector<std::string>& arguments,
+	std::ostream& out)
+{
+	sockaddr_un address{};
+	if (!fillSocketAddress(socketPath, address, out))
+		return 1;
+
+	const int server{ socket(AF_UNIX, SOCK_STREAM, 0) };
+	if (server == -1 || connect(server, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0)
+	{
+		out << "WADCLI: Could not reach a server at " << socketPath << ": " << std::strerror(errno) << '\n';
+		if (server != -1)
+			close(server);
+		return 1;
+	}
+
+	std::signal(SIGPIPE, SIG_IGN);
+
+	// Relative file names are relative to us, not to the server.
+	std::error_code error;
+	const std::string workingDirectory{ std::filesystem::current_path(error).string() };
+
+	const uint32_t numStrings{ static_cast<uint32_t>(arguments.size() + 1) };
+	bool sent{ WadServer::writeAll(server, reinterpret_cast<const char*>(&numStrings), sizeof(numStrings)) &&
+		WadServer::writeString(server, workingDirectory) };
+
+	for (size_t i = 0; i < arguments.size() && sent; ++i)
+		sent = WadServer::writeString(server, arguments[i]);
+
+	uint32_t status{ 1 };
+	std::string output{};
+	if (!sent || !WadServer::readAll(server, reinterpret_cast<char*>(&status), sizeof(status)) ||
+		!WadServer::readString(server, output, UINT32_MAX))
+	{
+		out << "WADCLI: The server at " << socketPath << " went away before answering.\n";
+		close(server);
+		return 1;
+	}
+
+	close(server);
+	out << output << std::flush;
+	return static_cast<int>(status);
+}
+
+bool WadServer::answerClient(int client)
+{
+	uint32_t numStrings{ 0 };
+	if (!WadServer::readAll(client, reinterpret_cast<char*>(&numStrings), sizeof(numStrings)) ||
+		numStrings == 0 || numStrings > maxRequestStrings)
+		return true;
+
+	std::vector<std::string> strings{};
+	strings.resize(numStrings);
+	for (std::string& string : strings)
+	{
+		if (!WadServer::readString(client, string, maxRequestStringSize))
+			return true;
+	}
+
+	const std::vector<std::string> arguments{ strings.begin() + 1, strings.end() };
+	std::ostringstream output{};
+	uint32_t status{ 0 };
+	bool stopping{ false };
+
+	// Errors WadFormat prints go back to the client too.
+	std::streambuf* errorBuffer{ std::cerr.rdbuf(output.rdbuf()) };
+
+	if (arguments.size() == 1 && arguments[0] == "--stop")
+	{
+		output << "WADCLI: Stopping the server.\n";
+		stopping = true;
+	}
+	else if (arguments.empty())
+	{
+		output << unknownMessage;
+		status = 1;
+	}
+	else
+	{
+		std::error_code error;
+		std::filesystem::current_path(strings[0], error);
+
+		if (error)
+		{
+			output << "WADCLI: Could not work from " << strings[0] << ": " << error.message() << '\n';
+			status = 1;
+		}
+		else if (!session.runCommand(arguments, output))
+			status = 1;
+	}
+
+	std::cerr.rdbuf(errorBuffer);
+
+	if (WadServer::writeAll(client, reinterpret_cast<const char*>(&status), sizeof(status)))
+		WadServer::writeString(client, output.str());
+
+	return !stopping;
+}
+
+bool WadServer::readAll(int socket, char* data, size_t size)
+{
+	while (size > 0)
+	{
+		const ssize_t readBytes{ read(socket, data, size) };
+		if (readBytes < 0 && errno == EINTR)
+			continue;
+		if (readBytes <= 0)
+			return false;
+
+		data += readBytes;
+		size -= static_cast<size_t>(readBytes);
+	}
+
+	return true;
+}
+
+bool WadServer::writeAll(int socket, const char* data, size_t size)
+{
+	while (size > 0)
+	{
+		const ssize_t writtenBytes{ write(socket, data, size) };
+		if (writtenBytes < 0 && errno == EINTR)
+			continue;
+		if (writtenBytes <= 0)
+			return false;
+
+		data += writtenBytes;
+		size -= static_cast<size_t>(writtenBytes);
+	}
+
+	return true;
+}
+
+bool WadServer::readString(int socket, std::string& string, uint32_t maxSize)
+{
+	uint32_t size{ 0 };
+	if (!WadServer::readAll(socket, reinterpret_cast<char*>(&size), sizeof(size)) || size > maxSize)
+		return false;
+
+	string.resize(size);
+	return WadServer::readAll(socket, string.data(), size);
+}
+
+bool WadServer::writeString(int socket, std::string_view string)
+{
+	const uint32_t size{ static_cast<uint32_t>(string.size()) };
+	return WadServer::writeAll(socket, reinterpret_cast<const char*>(&size), sizeof(size)) &&
+		WadServer::writeAll(socket, string.data(), string.size());
+}
+#endif
@@ -0,0 +1,410 @@
+/*
+Copyright (c) 2021, JugadorXEI
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice,
+this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <filesystem>
+#include <string>
+#include <iomanip>
+#include <algorithm>
+#include "headers/wadsession.h"
+
+WadSession::WadSession()
+	: wads{}, threadPool{}, maxWADs{ 0 }, writingThrough{ false }, useCounter{ 0 }
+{
+	// empty.
+}
+
+bool WadSession::runCommand(const std::vector<std::string>& arguments, std::ostream& out)
+{
+	CommandPlan plan{};
+	plan.setAskingForNames(false);
+	if (!plan.parseArguments(arguments, out))
+		return false;
+
+	// The standard input/output is where the commands and messages go.
+	if (plan.getWADFileName() == "-" || plan.getOutputName() == "-")
+	{
+		out << "WADCLI: WADs can't be read from or written to - when running several commands.\n";
+		return false;
+	}
+
+	ResidentWAD* resident{ (*this).loadWAD(plan, out) };
+	if (resident == nullptr)
+		return false;
+
+	if (plan.isListingOnly())
+	{
+		CommandPlan::listWAD(*(*resident).wad, out);
+		return true;
+	}
+
+	if (!plan.buildPlan((*(*resident).wad).getWADType(), out))
+		return false;
+
+	if (plan.isExplaining())
+	{
+		plan.explainPlan(out);
+		return true;
+	}
+
+	// With --output somewhere else, the WAD we read stays as it is, like it would on
+	// disk. The changes go to a copy that becomes that other WAD. Lumps are shared
+	// until something changes them, so it's only the file list that gets copied.
+	const std::string outputKey{ plan.getOutputName().empty() ? (*resident).key :
+		WadSession::getKeyForFileName(plan.getExportFileName()) };
+	const bool writtenElsewhere{ outputKey != (*resident).key };
+
+	std::unique_ptr<WadFormat> output{};
+	if (writtenElsewhere)
+		output = std::make_unique<WadFormat>(*(*resident).wad);
+
+	WadFormat& wad{ writtenElsewhere ? *output : *(*resident).wad };
+
+	if (threadPool == nullptr || (*threadPool).getNumThreads() != plan.getNumJobs())
+		threadPool = std::make_shared<ThreadPool>(plan.getNumJobs());
+
+	wad.setThreadPool(threadPool);
+	wad.setMaxMemory(plan.getMaxMemory());
+
+	if (!plan.executePlan(wad, out, false))
+	{
+		// Some of it might've been done, and none of it is getting written.
+		if (writingThrough && !writtenElsewhere)
+			(*this).forgetWAD(*resident);
+		return false;
+	}
+
+	if (writtenElsewhere)
+	{
+		resident = (*this).replaceWAD(outputKey, plan.getExportFileName(), std::move(output), out);
+		if (resident == nullptr)
+			return false;
+	}
+	else if (plan.changesWAD())
+	{
+		(*resident).changed = true;
+		(*resident).compact |= plan.isCompacting();
+	}
+
+	if (writingThrough && (*resident).changed)
+	{
+		const bool saved{ (*this).saveWAD(*resident, out) };
+
+		// The copy still points into the WAD it came from, the next
+		// command might as well read what actually got written.
+		if (!saved || writtenElsewhere)
+			(*this).forgetWAD(*resident);
+
+		return saved;
+	}
+
+	return true;
+}
+
+void WadSession::setMaxWADs(size_t newMaxWADs) { maxWADs = newMaxWADs; }
+void WadSession::setWriteThrough(bool writeThrough) { writingThrough = writeThrough; }
+
+bool WadSession::save(std::ostream& out, std::string_view wadFileName)
+{
+	if (!wadFileName.empty())
+	{
+		ResidentWAD* resident{ (*this).findWAD(wadFileName) };
+		if (resident == nullptr)
+		{
+			out << "WADCLI: " << wadFileName << " was never opened, nothing to save.\n";
+			return true;
+		}
+
+		return (*this).saveWAD(*resident, out);
+	}
+
+	for (ResidentWAD& resident : wads)
+	{
+		if (!(*this).saveWAD(resident, out))
+			return false;
+	}
+
+	return true;
+}
+
+bool WadSession::runScript(std::istream& script, std::ostream& out)
+{
+	std::string line{};
+	size_t lineNumber{ 0 };
+
+	while (std::getline(script, line))
+	{
+		lineNumber++;
+
+		std::vector<std::string> arguments{ WadSession::splitCommandLine(line) };
+
+		// Lines copied straight out of a shell script work too.
+		if (!arguments.empty() && arguments[0] == "wadcli")
+			arguments.erase(arguments.begin());
+
+		// Blank lines and comments.
+		if (arguments.empty())
+			continue;
+
+		bool success{ false };
+		if (arguments[0] == "save" && arguments.size() == 1)
+			success = (*this).save(out);
+		else if (arguments[0] == "save")
+		{
+			success = true;
+			for (size_t i = 1; i < arguments.size() && success; ++i)
+				success = (*this).save(out, arguments[i]);
+		}
+		else
+			success = (*this).runCommand(arguments, out);
+
+		if (!success)
+		{
+			out << "WADCLI: Stopped at line " << lineNumber << " of the script, " <<
+				"changes since the last save were not written.\n";
+			return false;
+		}
+	}
+
+	return (*this).save(out);
+}
+
+std::vector<std::string> WadSession::splitCommandLine(std::string_view line)
+{
+	std::vector<std::string> arguments{};
+	std::string argument{};
+	bool inArgument{ false };
+	char quote{ '\0' };
+
+	for (size_t i = 0; i < line.size(); ++i)
+	{
+		const char character{ line[i] };
+
+		if (quote != '\0')
+		{
+			// Single quotes take everything as it is, like in a shell.
+			if (character == quote)
+				quote = '\0';
+			else if (character == '\\' && quote == '"' && i + 1 < line.size())
+				argument += line[++i];
+			else
+				argument += character;
+		}
+		else if (character == '"' || character == '\'')
+		{
+			quote = character;
+			inArgument = true;
+		}
+		else if (character == '\\' && i + 1 < line.size())
+		{
+			argument += line[++i];
+			inArgument = true;
+		}
+		else if (character == '#' && !inArgument)
+			break;
+		else if (character == ' ' || character == '\t' || character == '\r')
+		{
+			if (inArgument)
+				arguments.push_back(std::move(argument));
+
+			argument.clear();
+			inArgument = false;
+		}
+		else
+		{
+			argument += character;
+			inArgument = true;
+		}
+	}
+
+	if (inArgument)
+		arguments.push_back(std::move(argument));
+
+	return arguments;
+}
+
+WadSession::ResidentWAD* WadSession::loadWAD(const CommandPlan& plan, std::ostream& out)
+{
+	const std::string& wadFileName{ plan.getWADFileName() };
+
+	ResidentWAD* resident{ (*this).findWAD(wadFileName) };
+
+	// Something else wrote to it since, so it has to be read again.
+	if (resident != nullptr && !(*resident).changed && (*this).isOutdated(*resident))
+	{
+		(*this).forgetWAD(*resident);
+		resident = nullptr;
+	}
+
+	if (resident != nullptr)
+	{
+		(*resident).lastUsed = ++useCounter;
+		return resident;
+	}
+
+	// Full paths from here on, the working directory might not stay the same.
+	ResidentWAD newWAD{};
+	newWAD.key = WadSession::getKeyForFileName(wadFileName);
+	newWAD.fileName = wadFileName;
+	newWAD.wad = std::make_unique<WadFormat>(wadFileName, plan.getTypeOfWADToCreate());
+
+	if (std::filesystem::exists(wadFileName))
+	{
+		// Even a listing reads the lumps, chances are something's going to need them later.
+		if (!(*newWAD.wad).importWAD(newWAD.key, plan.usesArena() ? ARENA : MAPPED))
+		{
+			out << "WADCLI: There was an error reading " <<
+				std::quoted(wadFileName) << ".\n" <<
+				"We are not allowed to read it.\n";
+			return nullptr;
+		}
+	}
+	else if (!plan.canCreateWAD())
+	{
+		out << "WADCLI: There was an error reading " << 
+			std::quoted(wadFileName) << ".\n" <<
+			"It may not exist.\n";
+		return nullptr;
+	}
+
+	if (!(*this).makeRoom(out))
+		return nullptr;
+
+	(*this).rememberFileState(newWAD);
+	newWAD.lastUsed = ++useCounter;
+
+	wads.push_back(std::move(newWAD));
+	return &wads.back();
+}
+
+WadSession::ResidentWAD* WadSession::replaceWAD(const std::string& key, std::string_view fileName,
+	std::unique_ptr<WadFormat> wad, std::ostream& out)
+{
+	// Whatever it had is written over, same as the file would be.
+	ResidentWAD* resident{ (*this).findWAD(key) };
+	if (resident == nullptr)
+	{
+		if (!(*this).makeRoom(out))
+			return nullptr;
+
+		ResidentWAD newWAD{};
+		newWAD.key = key;
+		wads.push_back(std::move(newWAD));
+		resident = &wads.back();
+	}
+
+	(*resident).fileName = fileName;
+	(*resident).wad = std::move(wad);
+	(*resident).changed = true;
+	(*resident).compact = false;
+	(*resident).lastUsed = ++useCounter;
+	return resident;
+}
+
+WadSession::ResidentWAD* WadSession::findWAD(std::string_view fileName)
+{
+	const std::string key{ WadSession::getKeyForFileName(fileName) };
+	for (ResidentWAD& resident : wads)
+	{
+		if (resident.key == key)
+			return &resident;
+	}
+
+	return nullptr;
+}
+
+bool WadSession::saveWAD(ResidentWAD& resident, std::ostream& out)
+{
+	if (!resident.changed)
+		return true;
+
+	if (!(*resident.wad).exportWAD(resident.key,
+		resident.compact ? ExportMode::REWRITE : ExportMode::IN_PLACE))
+	{
+		out << "WADCLI: There was an error writing " << resident.fileName << ".\n";
+		return false;
+	}
+
+	if (!writingThrough)
+		out << "WADCLI: Saved " << resident.fileName << ".\n";
+
+	resident.changed = false;
+	resident.compact = false;
+	(*this).rememberFileState(resident);
+	return true;
+}
+
+void WadSession::forgetWAD(ResidentWAD& resident)
+{
+	wads.erase(wads.begin() + (&resident - wads.data()));
+}
+
+bool WadSession::makeRoom(std::ostream& out)
+{
+	while (maxWADs != 0 && wads.size() >= maxWADs)
+	{
+		auto oldest{ std::min_element(wads.begin(), wads.end(),
+			[](const ResidentWAD& first, const ResidentWAD& second) { return first.lastUsed < second.lastUsed; }) };
+
+		// Changes don't get lost just because it's been a while.
+		if (!(*this).saveWAD(*oldest, out))
+			return false;
+
+		wads.erase(oldest);
+	}
+
+	return true;
+}
+
+bool WadSession::isOutdated(const ResidentWAD& resident)
+{
+	std::error_code error;
+	const std::filesystem::file_time_type modifiedTime{ std::filesystem::last_write_time(resident.key, error) };
+
+	// Gone, unless it never existed to begin with.
+	if (error)
+		return resident.modifiedTime != std::filesystem::file_time_type{};
+
+	const uintmax_t fileSize{ std::filesystem::file_size(resident.key, error) };
+	return error || modifiedTime != resident.modifiedTime || fileSize != resident.fileSize;
+}
+
+void WadSession::rememberFileState(ResidentWAD& resident)
+{
+	std::error_code error;
+	resident.modifiedTime = std::filesystem::last_write_time(resident.key, error);
+	if (error)
+		resident.modifiedTime = std::filesystem::file_time_type{};
+
+	resident.fileSize = std::filesystem::file_size(resident.key, error);
+	if (error)
+		resident.fileSize = 0;
+}
+
+std::string WadSession::getKeyForFileName(std::string_view fileName)
+{
+	std::error_code error;
+	std::filesystem::path path{ std::filesystem::weakly_canonical(std::filesystem::path{ fileName }, error) };
+	return error ? std::string{ fileName } : path.string();
+}
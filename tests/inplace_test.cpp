@@ -0,0 +1,192 @@
+/*
+Copyright (c) 2021, JugadorXEI
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice,
+this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include "testing.h"
+#include "../src/headers/wadformat.h"
+
+// What the file looked like every time it got synced.
+static std::vector<std::string> syncedFiles{};
+
+// Takes the place of the C library's fsync for everything linked into this test,
+// so we can see what's on disk at each point before really syncing it.
+extern "C" int fsync(int fd)
+{
+	std::string contents{};
+	char buffer[4096];
+	off_t offset{ 0 };
+	ssize_t bytesRead{ 0 };
+	while ((bytesRead = pread(fd, buffer, sizeof(buffer), offset)) > 0)
+	{
+		contents.append(buffer, static_cast<size_t>(bytesRead));
+		offset += bytesRead;
+	}
+
+	syncedFiles.push_back(std::move(contents));
+	return static_cast<int>(syscall(SYS_fsync, fd));
+}
+
+static void writeLE32(std::ofstream& file, uint32_t number)
+{
+	const char bytes[4]{ static_cast<char>(number), static_cast<char>(number >> 8),
+		static_cast<char>(number >> 16), static_cast<char>(number >> 24) };
+	file.write(bytes, sizeof(bytes));
+}
+
+static uint32_t readLE32(const std::string& contents, size_t offset)
+{
+	uint32_t number{ 0 };
+	if (offset + sizeof(number) <= contents.size())
+		std::memcpy(&number, contents.data() + offset, sizeof(number));
+	return number;
+}
+
+static std::string readFile(const std::filesystem::path& path)
+{
+	std::ifstream file{ path, std::ios::binary };
+	return { std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>() };
+}
+
+// Lump i is size bytes of 'A' + i, and it's called LUMPA, LUMPB...
+static void writeWAD(const std::filesystem::path& path, unsigned int lumps, uint32_t size)
+{
+	std::ofstream file{ path, std::ios::binary | std::ios::trunc };
+	file.write("PWAD", 4);
+	writeLE32(file, lumps);
+	writeLE32(file, 12 + lumps * size);
+
+	for (unsigned int i = 0; i < lumps; ++i)
+	{
+		const std::string data(size, static_cast<char>('A' + i));
+		file.write(data.data(), data.size());
+	}
+
+	for (unsigned int i = 0; i < lumps; ++i)
+	{
+		writeLE32(file, 12 + i * size);
+		writeLE32(file, size);
+		char name[WadFormat::fileNameLength]{ 'L', 'U', 'M', 'P', static_cast<char>('A' + i) };
+		file.write(name, sizeof(name));
+	}
+}
+
+// A rename only changes the file list, so the new one gets appended,
+// and the header is the very last thing to change.
+static void testInPlace(const std::filesystem::path& path)
+{
+	const unsigned int numLumps{ 4 };
+	writeWAD(path, numLumps, 4096);
+	const std::string before{ readFile(path) };
+
+	WadFormat wad{};
+	CHECK(wad.importWAD(path.string()));
+	wad[1].setName("RENAMED");
+
+	syncedFiles.clear();
+	CHECK(wad.exportWAD(path.string(), ExportMode::IN_PLACE));
+
+	// Everything that was there is still there, the new file list goes after it.
+	const std::string after{ readFile(path) };
+	CHECK(after.size() == before.size() + numLumps * 16);
+	CHECK(after.compare(12, before.size() - 12, before, 12, before.size() - 12) == 0);
+	CHECK(readLE32(after, 8) == before.size());
+
+	// Once for the appended file list, once for the header.
+	CHECK(syncedFiles.size() == 2);
+	if (syncedFiles.size() == 2)
+	{
+		// The first time around, the new file list is on disk but the header
+		// still points at the old one, so the WAD reads as it was.
+		CHECK(syncedFiles[0].size() == after.size());
+		CHECK(syncedFiles[0].compare(0, 12, before, 0, 12) == 0);
+		CHECK(syncedFiles[0].compare(12, after.size() - 12, after, 12, after.size() - 12) == 0);
+		CHECK(syncedFiles[1] == after);
+	}
+
+	WadFormat reread{};
+	CHECK(reread.importWAD(path.string()));
+	CHECK(reread.getNumFiles() == numLumps);
+	if (reread.getNumFiles() == numLumps)
+	{
+		CHECK(reread[0].getName() == "LUMPA");
+		CHECK(reread[1].getName() == "RENAMED");
+		CHECK(reread[1].getSize() == 4096 && reread[1].getData()[4095] == 'B');
+	}
+}
+
+// Adding more than the WAD already has isn't worth appending,
+// it gets written from scratch like --compact would.
+static void testFallback(const std::filesystem::path& path, const std::filesystem::path& rewritten,
+	const std::filesystem::path& added)
+{
+	writeWAD(path, 1, 16);
+	writeWAD(rewritten, 1, 16);
+	{
+		std::ofstream file{ added, std::ios::binary | std::ios::trunc };
+		const std::string data(65536, 'Z');
+		file.write(data.data(), data.size());
+	}
+
+	WadFormat wad{};
+	CHECK(wad.importWAD(path.string()));
+	CHECK(wad.addFileToWAD(added.string(), "BIG"));
+	CHECK(wad.exportWAD(path.string(), ExportMode::IN_PLACE));
+
+	WadFormat compacted{};
+	CHECK(compacted.importWAD(rewritten.string()));
+	CHECK(compacted.addFileToWAD(added.string(), "BIG"));
+	CHECK(compacted.exportWAD(rewritten.string(), ExportMode::REWRITE));
+
+	const std::string after{ readFile(path) };
+	CHECK(after.size() == 12 + 16 + 65536 + 2 * 16);
+	CHECK(after == readFile(rewritten));
+}
+
+int main()
+{
+	const std::filesystem::path directory{ std::filesystem::temp_directory_path() };
+	const std::filesystem::path path{ directory / "wadcli_inplace_test.wad" };
+	const std::filesystem::path rewritten{ directory / "wadcli_inplace_test_rewritten.wad" };
+	const std::filesystem::path added{ directory / "wadcli_inplace_test.lmp" };
+
+	testInPlace(path);
+	testFallback(path, rewritten, added);
+
+	std::filesystem::remove(path);
+	std::filesystem::remove(rewritten);
+	std::filesystem::remove(added);
+
+	if (testFailures == 0)
+		std::cout << "inplace_test: all good.\n";
+
+	return testFailures == 0 ? 0 : 1;
+}
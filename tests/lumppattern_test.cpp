@@ -0,0 +1,175 @@
+/*
+Copyright (c) 2021, JugadorXEI
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice,
+this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <regex>
+#include <string>
+#include <vector>
+#include "testing.h"
+#include "../src/headers/lumppattern.h"
+#include "../src/headers/wadformat.h"
+
+static LumpPattern compiled(std::string_view text)
+{
+	LumpPattern pattern{};
+	std::string error{};
+	CHECK(pattern.compile(text, error));
+	return pattern;
+}
+
+// Why it doesn't compile, or nothing if it does.
+static std::string compileError(std::string_view text)
+{
+	LumpPattern pattern{};
+	std::string error{};
+	if (pattern.compile(text, error))
+		return "";
+
+	return error.empty() ? "(no reason given)" : error;
+}
+
+// What matchesName() should say, worked out the slow way from the unpacked name.
+static bool matchesSlowly(const LumpPattern& pattern, const std::string& lumpName)
+{
+	const std::string& name{ pattern.getName() };
+	if (pattern.getText().find('~') != std::string::npos)
+		return std::regex_match(lumpName, std::regex{ name });
+	if (name.empty())
+		return true;
+	if (name.find_first_of("*?") == std::string::npos)
+		return lumpName == name;
+
+	return LumpPattern::matchesGlob(lumpName, name);
+}
+
+int main()
+{
+	// Things that don't make sense. The whole command stops on these, so
+	// there has to be a reason to give.
+	CHECK(compileError("?0").find("count from 1") != std::string::npos);
+	CHECK(compileError("?5-2").find("count from 1") != std::string::npos);
+	CHECK(!compileError("").empty());
+	CHECK(!compileError("S_START..").empty());
+	CHECK(!compileError("..S_END").empty());
+	CHECK(!compileError("S_*..S_END").empty());
+	CHECK(!compileError("?3:").empty());
+	CHECK(compileError("~(DS").find("regular expression") != std::string::npos);
+	CHECK(compileError("?1").empty());
+	CHECK(compileError("?0X").empty());
+
+	// What each kind of pattern works out to.
+	const LumpPattern exact{ compiled("DSPISTOL") };
+	CHECK(exact.isExactName());
+	CHECK(exact.isDecidedByMask());
+	CHECK(!exact.hasIndexRange() && !exact.hasScope());
+
+	const LumpPattern single{ compiled("?5") };
+	CHECK(single.isSingleIndex());
+	CHECK(single.getFirstIndex() == 4 && single.getLastIndex() == 4);
+
+	const LumpPattern range{ compiled("?2-40:D*") };
+	CHECK(range.hasIndexRange() && !range.isSingleIndex());
+	CHECK(range.getFirstIndex() == 1 && range.getLastIndex() == 39);
+	CHECK(range.getName() == "D*");
+
+	const LumpPattern scope{ compiled("S_START..S_END:TROO*") };
+	CHECK(scope.hasScope() && !scope.isExactName());
+	CHECK(scope.getScopeStart() == "S_START" && scope.getScopeEnd() == "S_END");
+	CHECK(scope.getName() == "TROO*");
+
+	// ? followed by something other than a number is just a glob.
+	const LumpPattern glob{ compiled("?_START") };
+	CHECK(!glob.hasIndexRange());
+	CHECK(glob.matchesName(WadFormat::packLumpName("S_START")));
+	CHECK(!glob.matchesName(WadFormat::packLumpName("SS_START")));
+
+	// Longer than a lump name, so it's nobody's, not the lump it'd get cut down to.
+	const LumpPattern tooLong{ compiled("TEXTURE1X") };
+	CHECK(!tooLong.canMatch());
+	CHECK(!tooLong.matchesName(WadFormat::packLumpName("TEXTURE1")));
+	std::vector<std::string> captures{};
+	CHECK(!tooLong.matchCaptures("TEXTURE1", captures));
+
+	// Every pattern against every name, the packed way and the slow way.
+	const std::vector<std::string> names{ "", "A", "D", "DS", "DSPISTOL", "DSPISTO", "DSSHOTGN",
+		"S_START", "S_END", "SS_START", "F_START", "TEXTURE1", "TEXTURE2", "TROOA1", "TROOB1",
+		"VILE[1", "MAP01", "MAP10", "LUA_A", "THINGS", "D_RUNNIN", "12345678" };
+	const std::vector<std::string> patterns{ "DSPISTOL", "DS", "TEXTURE1", "DS*", "D*", "*", "**",
+		"*1", "T*1", "?_START", "??_START", "S_*", "*START", "MAP??", "MAP?", "DSPISTO?", "DSPISTO*",
+		"DSPISTOL*", "DSPISTOL?", "*_*", "????????", "?????????", "TEXTURE1*", "~DS(PI|SH).*",
+		"~MAP[0-9]+", "~.*_(START|END)", "~", "?1-5:D*", "A..B:TROO?1", "VILE[1" };
+
+	for (const std::string& text : patterns)
+	{
+		const LumpPattern pattern{ compiled(text) };
+		for (const std::string& name : names)
+		{
+			const bool expected{ matchesSlowly(pattern, name) };
+			if (pattern.matchesName(WadFormat::packLumpName(name)) != expected)
+			{
+				std::cerr << "  \"" << text << "\" on \"" << name << "\"\n";
+				CHECK(!"matchesName() doesn't agree");
+			}
+
+			// Both ways of asking have to agree.
+			if (pattern.matchCaptures(name, captures) != expected)
+			{
+				std::cerr << "  \"" << text << "\" on \"" << name << "\"\n";
+				CHECK(!"matchCaptures() doesn't agree");
+			}
+
+			// And if the mask says it's enough, it has to be.
+			if (pattern.isDecidedByMask() &&
+				((WadFormat::packLumpName(name) & pattern.getNameMask()) == pattern.getNameValue()) != expected)
+			{
+				std::cerr << "  \"" << text << "\" on \"" << name << "\"\n";
+				CHECK(!"the mask isn't enough");
+			}
+		}
+	}
+
+	// What gets captured, and what it turns into.
+	CHECK(compiled("DS*").matchCaptures("DSPISTOL", captures));
+	CHECK((captures == std::vector<std::string>{ "DSPISTOL", "PISTOL" }));
+
+	CHECK(compiled("*_*").matchCaptures("S_START", captures));
+	CHECK((captures == std::vector<std::string>{ "S_START", "S", "START" }));
+
+	CHECK(compiled("?_START").matchCaptures("F_START", captures));
+	CHECK((captures == std::vector<std::string>{ "F_START", "F" }));
+
+	CHECK(compiled("~DS(PI|SH)(.*)").matchCaptures("DSSHOTGN", captures));
+	CHECK((captures == std::vector<std::string>{ "DSSHOTGN", "SH", "OTGN" }));
+
+	CHECK(LumpPattern::fillTemplate("X$1", { "DSPISTOL", "PISTOL" }) == "XPISTOL");
+	CHECK(LumpPattern::fillTemplate("$0_", { "MAP01" }) == "MAP01_");
+	CHECK(LumpPattern::fillTemplate("A$$B", { "MAP01" }) == "A$B");
+	CHECK(LumpPattern::fillTemplate("A$9", { "MAP01" }) == "A");
+	CHECK(LumpPattern::fillTemplate("A$x$", { "MAP01" }) == "A$x$");
+
+	if (testFailures == 0)
+		std::cout << "lumppattern_test: all good.\n";
+
+	return testFailures == 0 ? 0 : 1;
+}
@@ -0,0 +1,137 @@
+/*
+Copyright (c) 2021, JugadorXEI
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice,
+this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "testing.h"
+#include "../src/headers/commandplan.h"
+#include "../src/headers/threadpool.h"
+#include "../src/headers/wadformat.h"
+
+static const unsigned int numLumps{ 16 };
+static const uint32_t lumpSize{ 4096 };
+
+static void writeLE32(std::ofstream& file, uint32_t number)
+{
+	const char bytes[4]{ static_cast<char>(number), static_cast<char>(number >> 8),
+		static_cast<char>(number >> 16), static_cast<char>(number >> 24) };
+	file.write(bytes, sizeof(bytes));
+}
+
+// Lump i is lumpSize bytes of 'A' + i, so it compresses well and we can tell it apart.
+static void writeWAD(const std::filesystem::path& path, unsigned int lumps)
+{
+	std::ofstream file{ path, std::ios::binary | std::ios::trunc };
+	file.write("PWAD", 4);
+	writeLE32(file, lumps);
+	writeLE32(file, 12 + lumps * lumpSize);
+
+	for (unsigned int i = 0; i < lumps; ++i)
+	{
+		const std::string data(lumpSize, static_cast<char>('A' + i));
+		file.write(data.data(), data.size());
+	}
+
+	for (unsigned int i = 0; i < lumps; ++i)
+	{
+		writeLE32(file, 12 + i * lumpSize);
+		writeLE32(file, lumpSize);
+		char name[WadFormat::fileNameLength]{ 'L', 'U', 'M', 'P', static_cast<char>('A' + i) };
+		file.write(name, sizeof(name));
+	}
+}
+
+// Merges the ZWAD into a PWAD, which decompresses it on the way in, and says
+// how many of the merged lumps were left sitting in memory.
+static unsigned int mergeZWAD(const std::filesystem::path& target, const std::filesystem::path& zwad,
+	const std::vector<std::string>& extraArguments)
+{
+	std::vector<std::string> arguments{ target.string(), "--merge", zwad.string() };
+	arguments.insert(arguments.end(), extraArguments.begin(), extraArguments.end());
+
+	std::ostringstream out{};
+	CommandPlan plan{};
+	CHECK(plan.parseArguments(arguments, out));
+
+	WadFormat wad{};
+	CHECK(wad.importWAD(target.string()));
+	CHECK(plan.buildPlan(wad.getWADType(), out));
+	wad.setThreadPool(std::make_shared<ThreadPool>(2));
+	CHECK(plan.executePlan(wad, out, false));
+
+	// The target's own lump, then everything from the ZWAD, decompressed.
+	CHECK(wad.getNumFiles() == 1 + numLumps);
+	unsigned int inMemory{ 0 };
+	for (unsigned int i = 1; i < wad.getNumFiles() && i <= numLumps; ++i)
+	{
+		const std::string expected(lumpSize, static_cast<char>('A' + i - 1));
+		CHECK(wad[i].getSize() == lumpSize);
+		CHECK(wad[i].getSize() == lumpSize && std::memcmp(wad[i].getData(), expected.data(), lumpSize) == 0);
+
+		const std::shared_ptr<MappedFile>& mappedFile{ wad[i].getLumpData().mappedFile };
+		if (mappedFile != nullptr && (*mappedFile).isInMemory())
+			++inMemory;
+	}
+
+	return inMemory;
+}
+
+int main()
+{
+	const std::filesystem::path directory{ std::filesystem::temp_directory_path() };
+	const std::filesystem::path target{ directory / "wadcli_maxmemory_test.wad" };
+	const std::filesystem::path source{ directory / "wadcli_maxmemory_test_source.wad" };
+	const std::filesystem::path zwad{ directory / "wadcli_maxmemory_test_z.wad" };
+
+	writeWAD(target, 1);
+	writeWAD(source, numLumps);
+
+	WadFormat compressing{};
+	compressing.setThreadPool(std::make_shared<ThreadPool>(2));
+	CHECK(compressing.importWAD(source.string()));
+	CHECK(compressing.compressWAD());
+	CHECK(compressing.exportWAD(zwad.string()));
+	CHECK(compressing.getWADType() == ZWAD);
+
+	// Without a budget the decompressed lumps just stay in memory...
+	CHECK(mergeZWAD(target, zwad, {}) == numLumps);
+
+	// ...and with one, they're moved out to scratch files a window at a time.
+	CHECK(mergeZWAD(target, zwad, { "--max-memory", "8K" }) == 0);
+
+	std::filesystem::remove(target);
+	std::filesystem::remove(source);
+	std::filesystem::remove(zwad);
+
+	if (testFailures == 0)
+		std::cout << "maxmemory_test: all good.\n";
+
+	return testFailures == 0 ? 0 : 1;
+}
@@ -0,0 +1,196 @@
+/*
+Copyright (c) 2021, JugadorXEI
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice,
+this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+#include "testing.h"
+#include "../src/headers/wadformat.h"
+
+// A lump as the one-at-a-time moves see it: its name, and which one it was
+// at the start, which is also what its data says.
+struct Lump
+{
+	std::string name;
+	uint32_t id;
+};
+
+static void writeLE32(std::ofstream& file, uint32_t number)
+{
+	const char bytes[4]{ static_cast<char>(number), static_cast<char>(number >> 8),
+		static_cast<char>(number >> 16), static_cast<char>(number >> 24) };
+	file.write(bytes, sizeof(bytes));
+}
+
+// Every lump's data is its id, so we can tell them apart after they've moved.
+static void writeWAD(const std::filesystem::path& path, const std::vector<Lump>& lumps)
+{
+	std::ofstream file{ path, std::ios::binary | std::ios::trunc };
+	file.write("PWAD", 4);
+	writeLE32(file, static_cast<uint32_t>(lumps.size()));
+	writeLE32(file, static_cast<uint32_t>(12 + 4 * lumps.size()));
+
+	for (const Lump& lump : lumps)
+		writeLE32(file, lump.id);
+
+	for (size_t i = 0; i < lumps.size(); ++i)
+	{
+		writeLE32(file, static_cast<uint32_t>(12 + 4 * i));
+		writeLE32(file, 4);
+		char name[WadFormat::fileNameLength]{};
+		std::memcpy(name, lumps[i].name.data(), lumps[i].name.size());
+		file.write(name, sizeof(name));
+	}
+}
+
+static int findFirst(const std::vector<Lump>& lumps, const std::string& name)
+{
+	for (size_t i = 0; i < lumps.size(); ++i)
+	{
+		if (lumps[i].name == name)
+			return static_cast<int>(i);
+	}
+
+	return -1;
+}
+
+// One move at a time, the way --position and --swap always did them.
+static bool moveSlowly(std::vector<Lump>& lumps, const LumpMove& move)
+{
+	if (move.type == MoveType::SWAP_WITH)
+	{
+		// Once through, keeping the latest of each name until both have turned up.
+		int index1{ -1 }, index2{ -1 };
+		for (size_t i = 0; i < lumps.size(); ++i)
+		{
+			if (lumps[i].name == move.name)
+				index1 = static_cast<int>(i);
+			else if (lumps[i].name == move.otherName)
+				index2 = static_cast<int>(i);
+
+			if (index1 != -1 && index2 != -1)
+				break;
+		}
+
+		if (index1 == -1 || index2 == -1)
+			return false;
+
+		std::swap(lumps[index1], lumps[index2]);
+		return true;
+	}
+
+	const int index{ findFirst(lumps, move.name) };
+	if (index == -1)
+		return false;
+
+	const int finalIndex{ move.relative ? index + move.position : move.position };
+	if (finalIndex < 0 || finalIndex >= static_cast<int>(lumps.size()))
+		return false;
+
+	if (finalIndex < index)
+		std::rotate(lumps.begin() + finalIndex, lumps.begin() + index, lumps.begin() + index + 1);
+	else
+		std::rotate(lumps.begin() + index, lumps.begin() + index + 1, lumps.begin() + finalIndex + 1);
+
+	return true;
+}
+
+int main()
+{
+	const std::filesystem::path path{ std::filesystem::temp_directory_path() / "wadcli_movelumps_test.wad" };
+	const std::vector<std::string> names{ "THINGS", "LINEDEFS", "MAP01", "LUA_A", "DSPISTOL", "S_START", "NOPE" };
+	std::mt19937 random{ 5 };
+
+	for (int round = 0; round < 500; ++round)
+	{
+		// Fewer names than lumps, so there are plenty of duplicates. NOPE never shows up.
+		std::vector<Lump> lumps(1 + random() % 40);
+		for (size_t i = 0; i < lumps.size(); ++i)
+			lumps[i] = { names[random() % (names.size() - 1)], static_cast<uint32_t>(i) };
+
+		std::vector<LumpMove> moves(1 + random() % 12);
+		for (LumpMove& move : moves)
+		{
+			move.name = names[random() % names.size()];
+			if (random() % 3 == 0)
+			{
+				move.type = MoveType::SWAP_WITH;
+				move.otherName = names[random() % names.size()];
+			}
+			else
+			{
+				// Some of them off either end, which has to fail without doing anything.
+				move.relative = random() % 2 == 0;
+				const int reach{ static_cast<int>(lumps.size()) + 2 };
+				move.position = static_cast<int>(random() % (2 * reach)) - (move.relative ? reach : 2);
+			}
+		}
+
+		writeWAD(path, lumps);
+		WadFormat wad{};
+		CHECK(wad.importWAD(path.string()));
+
+		const std::vector<uint8_t> results{ wad.moveLumps(moves) };
+		CHECK(results.size() == moves.size());
+
+		for (size_t i = 0; i < moves.size() && i < results.size(); ++i)
+		{
+			if (moveSlowly(lumps, moves[i]) != static_cast<bool>(results[i]))
+			{
+				std::cerr << "  round " << round << ", move " << i << " on " << moves[i].name << '\n';
+				CHECK(!"moveLumps() doesn't agree on whether a move worked");
+			}
+		}
+
+		// Same lumps, in the same order, with the same data.
+		CHECK(wad.getNumFiles() == lumps.size());
+		for (uint32_t i = 0; i < wad.getNumFiles() && i < lumps.size(); ++i)
+		{
+			uint32_t id{ 0 };
+			std::memcpy(&id, wad[i].getData(), sizeof(id));
+			if (wad[i].getName() != lumps[i].name || id != lumps[i].id)
+			{
+				std::cerr << "  round " << round << ", lump " << i << '\n';
+				CHECK(!"moveLumps() put a lump somewhere else");
+				break;
+			}
+		}
+
+		// The name index has to know where everything went.
+		for (const std::string& name : names)
+			CHECK(wad.findFileByName(name) == findFirst(lumps, name));
+	}
+
+	std::filesystem::remove(path);
+
+	if (testFailures == 0)
+		std::cout << "movelumps_test: all good.\n";
+
+	return testFailures == 0 ? 0 : 1;
+}
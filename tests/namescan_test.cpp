@@ -0,0 +1,118 @@
+/*
+Copyright (c) 2021, JugadorXEI
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice,
+this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <random>
+#include <string>
+#include <vector>
+#include "testing.h"
+#include "../src/headers/namescan.h"
+#include "../src/headers/wadformat.h"
+
+using Kernel = void (*)(const uint64_t*, uint32_t, uint32_t, uint64_t, uint64_t, std::vector<unsigned int>&);
+
+// Whatever kernels this CPU can run, besides the scalar one.
+static std::vector<std::pair<Kernel, std::string>> getVectorKernels()
+{
+	std::vector<std::pair<Kernel, std::string>> kernels{};
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("sse2"))
+		kernels.push_back({ &NameScan::findMatchingSSE2, "SSE2" });
+	if (__builtin_cpu_supports("avx2"))
+		kernels.push_back({ &NameScan::findMatchingAVX2, "AVX2" });
+#endif
+	return kernels;
+}
+
+int main()
+{
+	const std::vector<std::pair<Kernel, std::string>> kernels{ getVectorKernels() };
+	std::mt19937_64 random{ 8 };
+
+	// Real looking names, lots of them sharing a start, so masks find some.
+	const std::vector<std::string> starts{ "DS", "D_", "S_", "F_", "TROO", "MAP", "THINGS", "LUA_", "" };
+	std::vector<uint64_t> names(1000);
+	for (uint64_t& name : names)
+	{
+		std::string text{ starts[random() % starts.size()] };
+		while (text.size() < 8 && random() % 3 != 0)
+			text += static_cast<char>('A' + random() % 26);
+		name = WadFormat::packLumpName(text);
+	}
+
+	// Masks like the ones patterns make, and some that are just noise.
+	std::vector<std::pair<uint64_t, uint64_t>> masks{};
+	for (const std::string& start : starts)
+	{
+		const uint64_t mask{ start.empty() ? 0 : (~0ull >> (64 - 8 * start.size())) };
+		masks.push_back({ mask, WadFormat::packLumpName(start) & mask });
+	}
+
+	for (int i = 0; i < 50; ++i)
+	{
+		const uint64_t mask{ random() & random() };
+		masks.push_back({ mask, names[random() % names.size()] & mask });
+	}
+
+	for (const auto& [mask, value] : masks)
+	{
+		// Short and odd ranges too, so the leftovers after the vectors get checked.
+		for (int i = 0; i < 40; ++i)
+		{
+			uint32_t first{ static_cast<uint32_t>(random() % names.size()) };
+			uint32_t last{ static_cast<uint32_t>(random() % names.size()) };
+			if (i < 20)
+				last = std::min<uint32_t>(first + i, static_cast<uint32_t>(names.size()));
+			if (first > last)
+				std::swap(first, last);
+
+			std::vector<unsigned int> expected{};
+			NameScan::findMatchingScalar(names.data(), first, last, mask, value, expected);
+
+			for (const auto& [kernel, kernelName] : kernels)
+			{
+				std::vector<unsigned int> found{};
+				kernel(names.data(), first, last, mask, value, found);
+				if (found != expected)
+				{
+					std::cerr << "  " << kernelName << " on [" << first << ", " << last << ")\n";
+					CHECK(!"a kernel doesn't agree with the scalar one");
+				}
+			}
+
+			// Whichever one gets picked, and it appends.
+			std::vector<unsigned int> found{ 12345 };
+			NameScan::findMatching(names.data(), first, last, mask, value, found);
+			expected.insert(expected.begin(), 12345);
+			CHECK(found == expected);
+		}
+	}
+
+	if (testFailures == 0)
+		std::cout << "namescan_test: all good, checked " << kernels.size() << " kernel(s) against the scalar one, "
+			<< NameScan::getKernelName() << " gets used.\n";
+
+	return testFailures == 0 ? 0 : 1;
+}
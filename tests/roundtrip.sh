@@ -0,0 +1,202 @@
+#!/bin/bash
+# Runs the same edits with this wadcli and with an older one, then checks that
+# the older one reads back the same lumps from both, and that --compact turns
+# ours into exactly the WAD the older one wrote.
+#
+# Usage: roundtrip.sh [wadcli]
+# The older wadcli is $BASE_WADCLI if set, otherwise it's built from $BASE_REV
+# (the first commit by default) with $DIRAFTER and $DIRLOC passed to make.
+
+NEW=$(realpath "${1:-./wadcli}")
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+if [ ! -x "$NEW" ]; then
+	echo "roundtrip: $NEW isn't there, build wadcli first."
+	exit 1
+fi
+
+if [ -n "$BASE_WADCLI" ]; then
+	BASE=$(realpath "$BASE_WADCLI")
+else
+	REV=${BASE_REV:-$(git rev-list --max-parents=0 HEAD | tail -n 1)}
+	mkdir -p "$WORK/base-src"
+	if ! git archive "$REV" | tar -x -C "$WORK/base-src" ||
+		! make -s -C "$WORK/base-src" DIRAFTER="$DIRAFTER" DIRLOC="$DIRLOC" > /dev/null; then
+		echo "roundtrip: couldn't build wadcli from $REV."
+		exit 1
+	fi
+	BASE="$WORK/base-src/wadcli"
+fi
+
+# Little endian, the way WADs have them.
+le32()
+{
+	printf "$(printf '\\x%02x\\x%02x\\x%02x\\x%02x' $(($1 & 255)) $((($1 >> 8) & 255)) \
+		$((($1 >> 16) & 255)) $((($1 >> 24) & 255)))"
+}
+
+# makewad [file] [name] [payload file] [name] [payload file] ...
+makewad()
+{
+	local out=$1; shift
+	local offset=12 count=0
+	: > "$out.data"
+	: > "$out.list"
+	while [ $# -gt 0 ]; do
+		local size=$(stat -c %s "$2")
+		cat "$2" >> "$out.data"
+		{ le32 $offset; le32 $size; printf "%-8.8s" "$1" | tr ' ' '\0'; } >> "$out.list"
+		offset=$((offset + size)); count=$((count + 1))
+		shift 2
+	done
+
+	{ printf "PWAD"; le32 $count; le32 $offset; cat "$out.data" "$out.list"; } > "$out"
+	rm "$out.data" "$out.list"
+}
+
+cd "$WORK"
+: > empty
+seq 1 700 > things
+seq 1000 3000 > linedefs
+head -c 5000 /dev/urandom > sprite1
+yes "print(\"hi\")" | head -n 200 > lua
+printf 'x' > tiny
+head -c 4096 /dev/zero > flat
+seq 1 50 > things2
+makewad test.wad MAP01 empty THINGS things LINEDEFS linedefs S_START empty TROOA1 sprite1 \
+	TROOB1 flat S_END empty LUA_A lua LUA_B tiny THINGS things2 DSPISTOL linedefs VILE[1 tiny
+makewad other.wad F_START empty FLAT1 flat F_END empty LUA_C lua
+cp lua NEWLUA
+cp flat NEWFLAT
+
+CASES=(
+	"--delete LUA_A"
+	"--delete ?3 VILE[1"
+	"--add NEWLUA NEWFLAT --rename LUA_D FLAT2"
+	"--add NEWFLAT --within S"
+	"--input LUA_A DSPISTOL --rename LUA_Z PISTOL"
+	"--input LUA_A TROOA1 --swap"
+	"--input THINGS DSPISTOL --swap"
+	"--input LUA_B --position 2"
+	"--input LUA_A TROOB1 --position +3"
+	"--input DSPISTOL --position -4"
+	"--create-markers P TX_START"
+	"--merge other.wad"
+	"--compress"
+)
+
+fail=0
+cases=0
+
+# Both sides start from the same files.
+fresh()
+{
+	rm -rf base new
+	mkdir base new
+	cp test.wad other.wad NEWLUA NEWFLAT base/
+	cp test.wad other.wad NEWLUA NEWFLAT new/
+}
+
+# sameWADs [what was done] [wad] ...
+sameWADs()
+{
+	local wad different=0
+	cases=$((cases + 1))
+	for wad in "${@:2}"; do
+		# The older wadcli has to read ours, and see the same lumps in it...
+		(cd base && "$BASE" "$wad" --extract-all --path "out-$wad/" > /dev/null 2>&1 < /dev/null)
+		(cd new && "$BASE" "$wad" --extract-all --path "out-$wad/" > /dev/null 2>&1 < /dev/null)
+
+		# ...and once the unused space is gone, it's the same file.
+		(cd new && "$NEW" "$wad" --compact > /dev/null 2>&1 < /dev/null)
+
+		if [ ! -f "base/$wad" ] || ! diff -r "base/out-$wad" "new/out-$wad" > /dev/null ||
+			! cmp -s "base/$wad" "new/$wad"; then
+			different=1
+		fi
+	done
+
+	if [ $different -ne 0 ]; then
+		echo "roundtrip: FAILED: $1"
+		fail=1
+	fi
+}
+
+for args in "${CASES[@]}"; do
+	fresh
+	(cd base && "$BASE" test.wad $args > /dev/null 2>&1 < /dev/null)
+	(cd new && "$NEW" test.wad $args > /dev/null 2>&1 < /dev/null)
+	sameWADs "test.wad $args" test.wad
+done
+
+# A script has to leave every WAD like running its lines one by one does,
+# --output included: the WAD a line read from stays as it was.
+SCRIPT=(
+	"test.wad --input THINGS --rename FOO --output out.wad"
+	"test.wad --input LINEDEFS --rename BAR"
+	"out.wad --input LUA_A --position 1"
+	"test.wad --delete VILE[1 --output out2.wad"
+	"out2.wad --add NEWLUA"
+)
+
+fresh
+for line in "${SCRIPT[@]}"; do
+	(cd base && "$BASE" $line > /dev/null 2>&1 < /dev/null)
+done
+(cd new && printf "%s\n" "${SCRIPT[@]}" | "$NEW" --script - > /dev/null 2>&1)
+sameWADs "--script with --output" test.wad out.wad out2.wad
+
+# A WAD sent to the standard output has to be the one --output would've written.
+fresh
+(cd base && "$BASE" test.wad --delete LUA_A --output piped.wad > /dev/null 2>&1 < /dev/null)
+(cd new && "$NEW" test.wad --delete LUA_A --output exported.wad > /dev/null 2>&1 < /dev/null &&
+	"$NEW" test.wad --delete LUA_A --output - > piped.wad 2> /dev/null < /dev/null)
+if ! cmp -s new/exported.wad new/piped.wad; then
+	echo "roundtrip: FAILED: --output - isn't what --output exported.wad wrote"
+	fail=1
+fi
+sameWADs "--output -" test.wad piped.wad
+
+# Same for a WAD read from the standard input, both from a pipe that can't
+# seek and from a file redirected into it, which goes to the standard output.
+fresh
+(cd base && "$BASE" test.wad --input LUA_B --position 2 --output stdin.wad > /dev/null 2>&1 < /dev/null)
+(cd new && "$NEW" test.wad --input LUA_B --position 2 --output exported.wad > /dev/null 2>&1 < /dev/null &&
+	cat test.wad | "$NEW" - --input LUA_B --position 2 > stdin.wad 2> /dev/null &&
+	"$NEW" - --input LUA_B --position 2 < test.wad > redirected.wad 2> /dev/null)
+if ! cmp -s new/exported.wad new/stdin.wad || ! cmp -s new/exported.wad new/redirected.wad; then
+	echo "roundtrip: FAILED: reading - isn't what reading test.wad gave"
+	fail=1
+fi
+sameWADs "reading -" test.wad stdin.wad
+
+# Compressing and decompressing has to give back what we started with.
+cases=$((cases + 1))
+rm -rf new
+mkdir new
+cp test.wad new/
+(cd new && "$NEW" test.wad --compress --output z.wad > /dev/null 2>&1 &&
+	"$NEW" z.wad --output back.wad --decompress > /dev/null 2>&1)
+if ! cmp -s test.wad new/back.wad; then
+	echo "roundtrip: FAILED: --compress then --decompress"
+	fail=1
+fi
+
+# Lumps that don't compress get stored as they are, even after something
+# else went wrong first, like a WAD to merge that isn't there.
+cases=$((cases + 1))
+rm -rf new
+mkdir new
+cp test.wad new/
+(cd new && "$NEW" test.wad --jobs 1 --merge missing.wad --compress --output z.wad > /dev/null 2>&1 &&
+	"$NEW" z.wad --output back.wad --decompress > /dev/null 2>&1)
+if ! cmp -s test.wad new/back.wad; then
+	echo "roundtrip: FAILED: --compress after a failed --merge"
+	fail=1
+fi
+
+if [ $fail -eq 0 ]; then
+	echo "roundtrip: all $cases cases passed."
+fi
+exit $fail